@@ -0,0 +1,156 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_BENCH_BENCHMARK_HPP
+#define STATELESS_BENCH_BENCHMARK_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace stateless_bench
+{
+
+/// Number of heap allocations made by the process so far.
+std::size_t allocations();
+
+/**
+ * Prevent the compiler from discarding a computed value. The empty asm
+ * statement claims to read the value and clobber memory, so the computation
+ * cannot be elided or moved across the barrier.
+ */
+template<typename T>
+inline void keep(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static volatile char sink;
+  sink = *reinterpret_cast<const volatile char*>(&value);
+#endif
+}
+
+/**
+ * Measures and reports the cost of repeatedly executing an operation.
+ *
+ * For each operation the runner reports the mean time per operation over a
+ * timed run, the median and 99th percentile of individually timed
+ * operations, and the mean number of heap allocations per operation.
+ */
+class runner
+{
+public:
+  typedef std::chrono::steady_clock clock;
+
+  /**
+   * \param filter Only operations whose name contains the filter are run.
+   * \param min_time Minimum duration of the timed run of each operation.
+   */
+  runner(const std::string& filter, std::chrono::milliseconds min_time)
+    : filter_(filter)
+    , min_time_(min_time)
+  {}
+
+  void print_header() const
+  {
+    std::printf("%-48s %12s %10s %10s %12s\n",
+      "benchmark", "ns/op", "p50 ns", "p99 ns", "allocs/op");
+  }
+
+  /**
+   * Measure an operation.
+   *
+   * \param name Name under which the results are reported.
+   * \param operation Callable executing the operation once.
+   */
+  template<typename TOperation>
+  void run(const std::string& name, TOperation operation)
+  {
+    if (name.find(filter_) == std::string::npos)
+    {
+      return;
+    }
+
+    // Warm up and estimate the number of iterations to fill the minimum time.
+    std::size_t iterations = 1;
+    for (;;)
+    {
+      const auto elapsed = time(operation, iterations);
+      if (elapsed >= min_time_ / 10)
+      {
+        iterations = static_cast<std::size_t>(
+          iterations * 10 * (static_cast<double>(clock::duration(min_time_).count()) /
+          static_cast<double>(elapsed.count()) / 10.0)) + 1;
+        break;
+      }
+      iterations *= 10;
+    }
+
+    const auto allocations_before = allocations();
+    const auto elapsed = time(operation, iterations);
+    const auto allocated = allocations() - allocations_before;
+
+    std::vector<double> samples(iterations < max_samples ? iterations : max_samples);
+    for (auto& sample : samples)
+    {
+      const auto start = clock::now();
+      operation();
+      sample = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+    std::sort(samples.begin(), samples.end());
+
+    std::printf("%-48s %12.1f %10.0f %10.0f %12.2f\n",
+      name.c_str(),
+      std::chrono::duration<double, std::nano>(elapsed).count() / iterations,
+      samples[samples.size() / 2],
+      samples[samples.size() * 99 / 100],
+      static_cast<double>(allocated) / iterations);
+    std::fflush(stdout);
+  }
+
+private:
+  static const std::size_t max_samples = 100000;
+
+  template<typename TOperation>
+  static clock::duration time(TOperation& operation, std::size_t iterations)
+  {
+    const auto start = clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+      operation();
+    }
+    return clock::now() - start;
+  }
+
+  std::string filter_;
+  std::chrono::milliseconds min_time_;
+};
+
+/// Benchmarks modelled after the examples of the same name.
+void bench_on_off(runner& r);
+void bench_motor(runner& r);
+void bench_telephone_call(runner& r);
+void bench_bug_tracker(runner& r);
+void bench_grasping(runner& r);
+
+}
+
+#endif // STATELESS_BENCH_BENCHMARK_HPP
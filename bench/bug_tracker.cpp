@@ -0,0 +1,118 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// The bug tracker example: externally stored state and a trigger carrying a
+// string parameter.
+
+#include "benchmark.hpp"
+
+#include <stateless++/state_machine.hpp>
+
+#include <memory>
+#include <string>
+
+namespace stateless_bench
+{
+
+namespace
+{
+
+enum class state { open, assigned, deferred, resolved, closed };
+enum class trigger { open, assign, defer, resolve, close };
+
+typedef stateless::state_machine<state, trigger> TStateMachine;
+typedef TStateMachine::TTransition TTransition;
+typedef std::shared_ptr<stateless::trigger_with_parameters<trigger, std::string>> TAssignTrigger;
+
+class bug
+{
+public:
+  bug()
+    : state_(state::open)
+    , sm_([this]{ return state_; }, [this](const state& s){ state_ = s; })
+    , assign_trigger_(sm_.set_trigger_parameters<std::string>(trigger::assign))
+    , resolve_trigger_(sm_.set_trigger_parameters<std::string>(trigger::resolve))
+  {
+    sm_.configure(state::open)
+      .permit(trigger::assign, state::assigned);
+
+    sm_.configure(state::assigned)
+      .sub_state_of(state::open)
+      .on_entry_from(
+        assign_trigger_,
+        [this](const TTransition&, const std::string& a) { assignee_ = a; })
+      .permit_reentry(trigger::assign)
+      .permit(trigger::resolve, state::resolved)
+      .permit(trigger::close, state::closed)
+      .permit(trigger::defer, state::deferred)
+      .on_exit([this](const TTransition&) { assignee_.clear(); });
+
+    sm_.configure(state::deferred)
+      .permit(trigger::assign, state::assigned);
+
+    sm_.configure(state::resolved)
+      .on_entry<std::string>(
+        [this](const TTransition&, const std::string& a) { assignee_ = a; })
+      .permit(trigger::close, state::closed)
+      .permit(trigger::open, state::open);
+
+    sm_.configure(state::closed)
+      .permit(trigger::open, state::open);
+  }
+
+  TStateMachine& machine() { return sm_; }
+
+  void assign(const std::string& assignee) { sm_.fire(assign_trigger_, assignee); }
+
+  void resolve(const std::string& assignee) { sm_.fire(resolve_trigger_, assignee); }
+
+private:
+  state state_;
+  std::string assignee_;
+  TStateMachine sm_;
+  TAssignTrigger assign_trigger_;
+  TAssignTrigger resolve_trigger_;
+};
+
+}
+
+void bench_bug_tracker(runner& r)
+{
+  const std::string joe("Joe"), harry("Harry");
+
+  bug b;
+  r.run("bug_tracker/lifecycle", [&]
+    {
+      b.assign(joe);
+      b.machine().fire(trigger::defer);
+      b.assign(harry);
+      b.resolve(joe);
+      b.machine().fire(trigger::close);
+      b.machine().fire(trigger::open);
+    });
+
+  b.assign(joe);
+  r.run("bug_tracker/reassign", [&]{ b.assign(harry); });
+  r.run("bug_tracker/can_fire", [&]{ keep(b.machine().can_fire(trigger::resolve)); });
+
+  bug frozen;
+  frozen.machine().freeze();
+  frozen.assign(joe);
+  r.run("bug_tracker/frozen/reassign", [&]{ frozen.assign(harry); });
+}
+
+}
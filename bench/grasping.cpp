@@ -0,0 +1,113 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// A hierarchy shaped like the grasping example: string states nested three
+// levels deep, transitions between the leaves of different subtrees and
+// triggers deferred while a transition is in progress.
+
+#include "benchmark.hpp"
+
+#include <stateless++/state_machine.hpp>
+
+#include <string>
+
+namespace stateless_bench
+{
+
+namespace
+{
+
+typedef stateless::state_machine<std::string, std::string> TStateMachine;
+typedef TStateMachine::TTransition TTransition;
+
+const char* const task = "task";
+const char* const picking = "picking";
+const char* const placing = "placing";
+const char* const approach_pick = "picking/approach";
+const char* const grasp = "picking/grasp";
+const char* const close_gripper = "picking/grasp/close_gripper";
+const char* const lift = "picking/grasp/lift";
+const char* const approach_place = "placing/approach";
+const char* const release = "placing/release";
+
+void configure(TStateMachine& sm, int& actions)
+{
+  const auto count = [&](const TTransition&) { ++actions; };
+
+  sm.configure(picking).sub_state_of(task).on_entry(count).on_exit(count);
+  sm.configure(placing).sub_state_of(task).on_entry(count).on_exit(count);
+  sm.configure(grasp).sub_state_of(picking).on_entry(count).on_exit(count);
+
+  sm.configure(approach_pick).sub_state_of(picking)
+    .permit("arrived", close_gripper);
+  sm.configure(close_gripper).sub_state_of(grasp)
+    .permit("closed", lift);
+  sm.configure(lift).sub_state_of(grasp)
+    .permit("lifted", approach_place);
+  sm.configure(approach_place).sub_state_of(placing)
+    .permit("arrived", release);
+  sm.configure(release).sub_state_of(placing)
+    .permit("opened", approach_pick);
+  sm.configure(task)
+    .permit("abort", approach_pick);
+}
+
+void cycle(TStateMachine& sm)
+{
+  sm.fire("arrived");
+  sm.fire("closed");
+  sm.fire("lifted");
+  sm.fire("arrived");
+  sm.fire("opened");
+}
+
+}
+
+void bench_grasping(runner& r)
+{
+  int actions = 0;
+
+  TStateMachine sm(approach_pick);
+  configure(sm, actions);
+  r.run("grasping/cycle", [&]{ cycle(sm); });
+
+  sm.fire("arrived");
+  r.run("grasping/is_in_root_state", [&]{ keep(sm.is_in_state(task)); });
+  r.run("grasping/can_fire_from_root_state", [&]{ keep(sm.can_fire("abort")); });
+
+  r.run("grasping/deferred", [&]
+    {
+      sm.push_deferred_trigger("abort");
+      sm.push_deferred_trigger("arrived");
+      while (sm.pop_deferred_trigger())
+      {
+      }
+    });
+
+  TStateMachine frozen(approach_pick);
+  configure(frozen, actions);
+  frozen.freeze();
+  r.run("grasping/frozen/cycle", [&]{ cycle(frozen); });
+  frozen.fire("arrived");
+  r.run("grasping/frozen/is_in_root_state", [&]{ keep(frozen.is_in_state(task)); });
+  const auto task_id = frozen.state_id(task);
+  r.run("grasping/frozen/is_in_root_state_id", [&]{ keep(frozen.is_in_state_id(task_id)); });
+
+  keep(actions);
+}
+
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "benchmark.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+
+std::atomic<std::size_t> allocation_count(0);
+
+}
+
+// Count every heap allocation made by the benchmarks.
+void* operator new(std::size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace stateless_bench
+{
+
+std::size_t allocations()
+{
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  using namespace stateless_bench;
+
+  std::string filter;
+  long min_time_ms = 200;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strncmp(argv[i], "--min-time-ms=", 14) == 0)
+    {
+      min_time_ms = std::atol(argv[i] + 14);
+    }
+    else
+    {
+      filter = argv[i];
+    }
+  }
+
+  runner r(filter, std::chrono::milliseconds(min_time_ms));
+  r.print_header();
+  bench_on_off(r);
+  bench_motor(r);
+  bench_telephone_call(r);
+  bench_bug_tracker(r);
+  bench_grasping(r);
+
+  return EXIT_SUCCESS;
+}
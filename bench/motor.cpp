@@ -0,0 +1,122 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// The motor example: enum states and triggers, a parameterised trigger and
+// reentry into the running state.
+
+#include "benchmark.hpp"
+
+#include <stateless++/state_machine.hpp>
+
+namespace stateless_bench
+{
+
+namespace
+{
+
+enum class state { idle, stopped, started, running };
+enum class trigger { start, stop, set_speed, halt };
+
+typedef stateless::state_machine<state, trigger> TStateMachine;
+typedef TStateMachine::TTransition TTransition;
+
+class motor
+{
+public:
+  motor()
+    : sm_(state::idle)
+    , set_speed_trigger_(sm_.set_trigger_parameters<int>(trigger::set_speed))
+    , speed_(0)
+  {
+    sm_.configure(state::idle)
+      .permit(trigger::start, state::started);
+
+    sm_.configure(state::stopped)
+      .on_entry([=](const TTransition&) { speed_ = 0; })
+      .permit(trigger::halt, state::idle);
+
+    sm_.configure(state::started)
+      .permit(trigger::set_speed, state::running)
+      .permit(trigger::stop, state::stopped);
+
+    sm_.configure(state::running)
+      .on_entry_from(
+        set_speed_trigger_,
+        [=](const TTransition&, int speed) { speed_ = speed; })
+      .permit(trigger::stop, state::stopped)
+      .permit_reentry(trigger::set_speed);
+
+    sm_.on_unhandled_trigger([](const state&, const trigger&) {});
+  }
+
+  TStateMachine& machine() { return sm_; }
+
+  void set_speed(int speed) { sm_.fire(set_speed_trigger_, speed); }
+
+  int speed() const { return speed_; }
+
+private:
+  TStateMachine sm_;
+  std::shared_ptr<stateless::trigger_with_parameters<trigger, int>> set_speed_trigger_;
+  int speed_;
+};
+
+}
+
+void bench_motor(runner& r)
+{
+  motor m;
+  auto& sm = m.machine();
+
+  r.run("motor/cycle", [&]
+    {
+      sm.fire(trigger::start);
+      m.set_speed(10);
+      sm.fire(trigger::stop);
+      sm.fire(trigger::halt);
+    });
+
+  sm.fire(trigger::start);
+  m.set_speed(1);
+  int speed = 0;
+  r.run("motor/set_speed_reentry", [&]{ m.set_speed(++speed); keep(m.speed()); });
+  r.run("motor/unhandled", [&]{ sm.fire(trigger::halt); });
+  r.run("motor/try_fire_unhandled", [&]{ keep(sm.try_fire(trigger::halt)); });
+
+  motor throwing;
+  throwing.machine().on_unhandled_trigger(
+    [](const state&, const trigger&) { throw stateless::error("unhandled"); });
+  r.run("motor/fire_unhandled_throws", [&]
+    {
+      try
+      {
+        throwing.machine().fire(trigger::halt);
+      }
+      catch (const stateless::error&)
+      {
+      }
+    });
+  r.run("motor/can_fire", [&]{ keep(sm.can_fire(trigger::halt)); });
+
+  motor frozen;
+  frozen.machine().freeze();
+  frozen.machine().fire(trigger::start);
+  frozen.set_speed(1);
+  r.run("motor/frozen/set_speed_reentry", [&]{ frozen.set_speed(++speed); keep(frozen.speed()); });
+}
+
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// The switch of the on_off example: string states and char triggers.
+
+#include "benchmark.hpp"
+
+#include <stateless++/parallel_fire.hpp>
+#include <stateless++/state_machine.hpp>
+#include <stateless++/state_machine_pool.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stateless_bench
+{
+
+namespace
+{
+
+typedef stateless::state_machine<std::string, char> TStateMachine;
+
+template<typename TStateMachine>
+void configure(TStateMachine& sm)
+{
+  const std::string on("On"), off("Off");
+  sm.configure(off).permit(' ', on);
+  sm.configure(on).permit(' ', off);
+}
+
+}
+
+void bench_on_off(runner& r)
+{
+  TStateMachine sm("Off");
+  configure(sm);
+
+  r.run("on_off/fire", [&]{ sm.fire(' '); });
+  r.run("on_off/can_fire", [&]{ keep(sm.can_fire(' ')); });
+  r.run("on_off/permitted_triggers", [&]{ keep(sm.permitted_triggers()); });
+  r.run("on_off/is_in_state", [&]{ keep(sm.is_in_state("On")); });
+  r.run("on_off/print", [&]{ std::ostringstream oss; oss << sm; keep(oss); });
+
+  TStateMachine frozen("Off");
+  configure(frozen);
+  frozen.freeze();
+
+  r.run("on_off/frozen/fire", [&]{ frozen.fire(' '); });
+  r.run("on_off/frozen/can_fire", [&]{ keep(frozen.can_fire(' ')); });
+  r.run("on_off/frozen/is_in_state", [&]{ keep(frozen.is_in_state("On")); });
+  const auto on_id = frozen.state_id("On");
+  r.run("on_off/frozen/is_in_state_id", [&]{ keep(frozen.is_in_state_id(on_id)); });
+
+  std::string external("Off");
+  TStateMachine stored(
+    [&]{ return external; },
+    [&](const std::string& s){ external = s; });
+  configure(stored);
+  stored.freeze();
+
+  r.run("on_off/external/fire", [&]{ stored.fire(' '); });
+
+  const std::string burst(64, ' ');
+  r.run("on_off/frozen/fire_loop_64", [&]{ for (auto c : burst) frozen.fire(c); });
+  r.run("on_off/frozen/fire_all_64", [&]{ keep(frozen.fire_all(burst)); });
+  r.run("on_off/external/fire_loop_64", [&]{ for (auto c : burst) stored.fire(c); });
+  r.run("on_off/external/fire_all_64", [&]{ keep(stored.fire_all(burst)); });
+
+  stateless::machine_definition<std::string, char> definition;
+  configure(definition);
+  definition.freeze();
+  std::vector<stateless::machine_instance<std::string, char>> instances(
+    1024, definition.create_instance("Off"));
+  r.run("on_off/definition/fire_loop_1024", [&]{ for (auto& i : instances) definition.fire(i, ' '); });
+
+  stateless::state_machine_pool<std::string, char> pool(definition, 1024, "Off");
+  r.run("on_off/pool/fire_all_instances_1024", [&]{ keep(pool.fire_all_instances(' ')); });
+
+  stateless::state_machine_pool<std::string, char> fleet(definition, 65536, "Off");
+  stateless::parallel_executor executor;
+  r.run("on_off/pool/fire_all_instances_65536", [&]{ keep(fleet.fire_all_instances(' ')); });
+  r.run("on_off/pool/parallel_fire_all_instances_65536", [&]
+    {
+      keep(stateless::parallel_fire_all_instances(executor, fleet, ' '));
+    });
+}
+
+}
@@ -0,0 +1,194 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// The telephone_call example: enum states and triggers with an on_hold
+// substate, on the generic and the enum state machine and on a shared
+// machine definition.
+
+#include "benchmark.hpp"
+
+#include <stateless++/enum_state_machine.hpp>
+#include <stateless++/enum_state_machine_pool.hpp>
+#include <stateless++/machine_definition.hpp>
+#include <stateless++/state_machine.hpp>
+
+#include <bitset>
+#include <iterator>
+#include <vector>
+
+namespace stateless_bench
+{
+
+namespace
+{
+
+enum class state { off_hook, ringing, connected, on_hold, phone_destroyed };
+
+enum class trigger
+{
+  call_dialled,
+  hung_up,
+  call_connected,
+  left_message,
+  placed_on_hold,
+  taken_off_hold,
+  phone_hurled_against_wall
+};
+
+template<typename TStateMachine>
+void configure(TStateMachine& sm, int& calls)
+{
+  typedef typename TStateMachine::TTransition TTransition;
+
+  sm.configure(state::off_hook)
+    .permit(trigger::call_dialled, state::ringing);
+
+  sm.configure(state::ringing)
+    .permit(trigger::hung_up, state::off_hook)
+    .permit(trigger::call_connected, state::connected);
+
+  sm.configure(state::connected)
+    .on_entry([&](const TTransition&) { ++calls; })
+    .on_exit([&](const TTransition&) { ++calls; })
+    .permit(trigger::left_message, state::off_hook)
+    .permit(trigger::hung_up, state::off_hook)
+    .permit(trigger::placed_on_hold, state::on_hold);
+
+  sm.configure(state::on_hold)
+    .sub_state_of(state::connected)
+    .permit(trigger::taken_off_hold, state::connected)
+    .permit(trigger::hung_up, state::off_hook)
+    .permit(trigger::phone_hurled_against_wall, state::phone_destroyed);
+}
+
+template<typename TStateMachine>
+void call(TStateMachine& sm)
+{
+  sm.fire(trigger::call_dialled);
+  sm.fire(trigger::call_connected);
+  sm.fire(trigger::placed_on_hold);
+  sm.fire(trigger::taken_off_hold);
+  sm.fire(trigger::hung_up);
+}
+
+template<typename TStateMachine>
+void run(runner& r, const std::string& prefix, TStateMachine& sm)
+{
+  r.run(prefix + "/call", [&]{ call(sm); });
+
+  sm.fire(trigger::call_dialled);
+  sm.fire(trigger::call_connected);
+  sm.fire(trigger::placed_on_hold);
+  r.run(prefix + "/is_in_super_state", [&]{ keep(sm.is_in_state(state::connected)); });
+  r.run(prefix + "/can_fire_from_super_state", [&]{ keep(sm.can_fire(trigger::left_message)); });
+  r.run(prefix + "/permitted_triggers", [&]{ keep(sm.permitted_triggers()); });
+  r.run(prefix + "/for_each_permitted_trigger", [&]
+    {
+      std::size_t count = 0;
+      sm.for_each_permitted_trigger([&](const trigger&) { ++count; });
+      keep(count);
+    });
+
+  const trigger triggers[] = {
+    trigger::call_dialled, trigger::hung_up, trigger::left_message, trigger::taken_off_hold };
+  bool result[4];
+  r.run(prefix + "/can_fire_many", [&]
+    {
+      sm.can_fire_many(std::begin(triggers), std::end(triggers), result);
+      keep(result);
+    });
+}
+
+}
+
+void bench_telephone_call(runner& r)
+{
+  int calls = 0;
+
+  stateless::state_machine<state, trigger> sm(state::off_hook);
+  configure(sm, calls);
+  run(r, "telephone_call", sm);
+
+  stateless::state_machine<state, trigger> frozen(state::off_hook);
+  configure(frozen, calls);
+  frozen.freeze();
+  run(r, "telephone_call/frozen", frozen);
+  std::vector<bool> mask;
+  r.run("telephone_call/frozen/permitted_trigger_mask", [&]{ frozen.permitted_trigger_mask(mask); keep(mask); });
+
+  stateless::enum_state_machine<state, trigger, 5, 7> dense(state::off_hook);
+  configure(dense, calls);
+  run(r, "telephone_call/enum", dense);
+  std::bitset<7> dense_mask;
+  r.run("telephone_call/enum/permitted_trigger_mask", [&]{ dense.permitted_trigger_mask(dense_mask); keep(dense_mask); });
+
+  stateless::machine_definition<state, trigger> definition;
+  configure(definition, calls);
+  definition.freeze();
+  auto instance = definition.create_instance(state::off_hook);
+  r.run("telephone_call/definition/call", [&]
+    {
+      definition.fire(instance, trigger::call_dialled);
+      definition.fire(instance, trigger::call_connected);
+      definition.fire(instance, trigger::placed_on_hold);
+      definition.fire(instance, trigger::taken_off_hold);
+      definition.fire(instance, trigger::hung_up);
+    });
+  r.run("telephone_call/definition/create_instance", [&]{ keep(definition.create_instance(state::off_hook)); });
+
+  // A fleet in which one phone in 64 is connected, so left_message moves few
+  // instances. The moved phones are reconnected after each measurement.
+  stateless::enum_state_machine_pool<state, trigger, 5, 7> fleet(0, state::off_hook);
+  configure(fleet, calls);
+  fleet.configure(state::off_hook).ignore(trigger::left_message);
+  fleet.configure(state::ringing).ignore(trigger::left_message);
+  fleet.freeze();
+  std::vector<std::size_t> reconnect_ids;
+  std::vector<trigger> reconnect_triggers;
+  for (std::size_t i = 0; i < 65536; ++i)
+  {
+    const bool is_connected = i % 64 == 0;
+    fleet.add(is_connected ? state::connected : i % 2 == 0 ? state::ringing : state::off_hook);
+    if (is_connected)
+    {
+      reconnect_ids.insert(reconnect_ids.end(), 2, i);
+      reconnect_triggers.push_back(trigger::call_dialled);
+      reconnect_triggers.push_back(trigger::call_connected);
+    }
+  }
+  const struct { const char* name; stateless::detail::simd_level level; } levels[] = {
+    { "scalar", stateless::detail::simd_level::scalar },
+    { "sse42", stateless::detail::simd_level::sse42 },
+    { "avx2", stateless::detail::simd_level::avx2 } };
+  for (const auto& level : levels)
+  {
+    if (level.level > stateless::detail::detected_simd_level())
+    {
+      continue;
+    }
+    r.run(std::string("telephone_call/enum_pool/fire_all_instances_65536/") + level.name, [&]
+      {
+        keep(fleet.fire_all_instances(
+          trigger::left_message, stateless::batch_policy::continue_on_failure, level.level));
+        keep(fleet.fire(reconnect_ids, reconnect_triggers));
+      });
+  }
+
+  keep(calls);
+}
+
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_CONTAINER_POLICY_HPP
+#define STATELESS_CONTAINER_POLICY_HPP
+
+#include <map>
+#include <unordered_map>
+
+#include "detail/flat_map.hpp"
+
+namespace stateless
+{
+
+/**
+ * Container policies select the associative containers a state machine uses
+ * to look up states and triggers.
+ *
+ * A policy provides two metafunctions from key and value type to container type:
+ * - map, for the configuration, which grows while the state machine is configured.
+ * - index, for the lookup tables compiled when the state machine is frozen.
+ */
+
+/**
+ * Ordered containers. States and triggers must be less than comparable.
+ * This is the default policy.
+ */
+struct ordered_container_policy
+{
+  template<typename TKey, typename TValue>
+  struct map
+  {
+    typedef std::map<TKey, TValue> type;
+  };
+
+  template<typename TKey, typename TValue>
+  struct index
+  {
+    typedef detail::flat_map<TKey, TValue> type;
+  };
+};
+
+/**
+ * Hashed containers. States and triggers must be hashable with std::hash
+ * and equality comparable. Trigger values are only required to be less than
+ * comparable if permitted_triggers() is used.
+ */
+struct unordered_container_policy
+{
+  template<typename TKey, typename TValue>
+  struct map
+  {
+    typedef std::unordered_map<TKey, TValue> type;
+  };
+
+  template<typename TKey, typename TValue>
+  struct index
+  {
+    typedef std::unordered_map<TKey, TValue> type;
+  };
+};
+
+/**
+ * Sorted vectors. States and triggers must be less than comparable.
+ * Lookups are binary searches over contiguous memory.
+ */
+struct flat_container_policy
+{
+  template<typename TKey, typename TValue>
+  struct map
+  {
+    typedef detail::flat_map<TKey, TValue> type;
+  };
+
+  template<typename TKey, typename TValue>
+  struct index
+  {
+    typedef detail::flat_map<TKey, TValue> type;
+  };
+};
+
+}
+
+#endif // STATELESS_CONTAINER_POLICY_HPP
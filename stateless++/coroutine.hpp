@@ -0,0 +1,237 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_COROUTINE_HPP
+#define STATELESS_COROUTINE_HPP
+
+// Optional C++20 coroutine support; the rest of the library requires C++11 only.
+#if !defined(__cpp_impl_coroutine)
+#error "stateless++/coroutine.hpp requires a compiler and library with C++20 coroutines."
+#endif
+
+#include <coroutine>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "strand.hpp"
+
+namespace stateless
+{
+
+/**
+ * Drives a state_machine or enum_state_machine from coroutines.
+ *
+ * co_await fire_async(trigger, args...) fires the trigger and resumes the
+ * coroutine once every action posted to the strand, such as entry actions
+ * configured with on_entry(strand, action), has finished.
+ * co_await until_in_state(state) resumes the coroutine when the machine
+ * enters the state or one of its substates, without polling.
+ *
+ * Coroutines are resumed on the strand. The adapter takes over the
+ * on_transition hook of the machine, so register transition callbacks with
+ * the adapter's on_transition() instead; it must outlive any firing of the
+ * machine. The machine must not be fired concurrently with an until_in_state()
+ * wait being set up unless it is frozen.
+ *
+ * \tparam TStateMachine The state machine type.
+ */
+template<typename TStateMachine>
+class async_state_machine
+{
+public:
+  /// Parameterized state type.
+  typedef typename std::decay<decltype(std::declval<const TStateMachine&>().state())>::type TState;
+
+  /// Parameterized transition type.
+  typedef typename TStateMachine::TTransition TTransition;
+
+  /// Signature for handler for state transition.
+  typedef typename TStateMachine::TTransitionAction TTransitionAction;
+
+  /**
+   * \param sm The state machine to drive.
+   * \param actions The strand to which asynchronous actions are posted and on
+   *                which coroutines are resumed.
+   */
+  async_state_machine(TStateMachine& sm, const strand& actions)
+    : sm_(sm)
+    , actions_(actions)
+  {
+    sm_.on_transition([this](const TTransition& transition)
+      {
+        transitioned(transition);
+      });
+  }
+
+  ~async_state_machine()
+  {
+    sm_.on_transition(TTransitionAction());
+  }
+
+  async_state_machine(const async_state_machine&) = delete;
+  async_state_machine& operator=(const async_state_machine&) = delete;
+
+  /// The driven state machine.
+  TStateMachine& machine()
+  {
+    return sm_;
+  }
+
+  /**
+   * Register a callback that will be invoked every time the state machine
+   * transitions, before waiting coroutines are scheduled.
+   *
+   * \param action The action to execute, accepting the details of the transition.
+   */
+  void on_transition(const TTransitionAction& action)
+  {
+    on_transition_ = action;
+  }
+
+  /**
+   * Fire a trigger when awaited, resuming the awaiting coroutine on the strand
+   * after the actions posted by the transition have run.
+   *
+   * \param trigger The trigger, or trigger with parameters, to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \return An awaitable; errors raised by fire() are thrown from co_await.
+   */
+  template<typename TTriggerArg, typename... TParams>
+  auto fire_async(const TTriggerArg& trigger, TParams&&... args)
+  {
+    auto fire = [&sm = sm_, trigger, ...args = std::forward<TParams>(args)]() mutable
+      {
+        sm.fire(trigger, args...);
+      };
+    return fire_awaitable<decltype(fire)>{ std::move(fire), actions_ };
+  }
+
+  /**
+   * Wait for the machine to be in a state or one of its substates. Completes
+   * immediately if it already is; otherwise the awaiting coroutine is resumed
+   * on the strand after the transition into the state. It may be resumed before
+   * entry actions posted by that transition have run.
+   *
+   * \param state The state to wait for.
+   */
+  auto until_in_state(const TState& state)
+  {
+    return state_awaitable{ *this, state };
+  }
+
+private:
+  template<typename TFire>
+  struct fire_awaitable
+  {
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine)
+    {
+      fire();
+      // Posted after the actions of the transition, so it runs once they have finished.
+      actions.post([coroutine]{ coroutine.resume(); });
+    }
+
+    void await_resume() const noexcept
+    {}
+
+    TFire fire;
+    strand actions;
+  };
+
+  struct state_awaitable
+  {
+    bool await_ready() const
+    {
+      return owner.sm_.is_in_state(state);
+    }
+
+    bool await_suspend(std::coroutine_handle<> coroutine)
+    {
+      std::lock_guard<std::mutex> lock(owner.mutex_);
+      // Checked again under the lock, which the transition hook also takes.
+      if (owner.sm_.is_in_state(state))
+      {
+        return false;
+      }
+      owner.waiters_.push_back(waiter{ state, coroutine });
+      return true;
+    }
+
+    void await_resume() const noexcept
+    {}
+
+    async_state_machine& owner;
+    TState state;
+  };
+
+  /// A coroutine waiting in until_in_state().
+  struct waiter
+  {
+    TState state;
+    std::coroutine_handle<> coroutine;
+  };
+
+  /// Schedule the coroutines waiting for a state the machine is now in.
+  void transitioned(const TTransition& transition)
+  {
+    if (on_transition_)
+    {
+      on_transition_(transition);
+    }
+    std::vector<std::coroutine_handle<>> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = waiters_.begin(); it != waiters_.end();)
+      {
+        if (sm_.is_in_state(it->state))
+        {
+          ready.push_back(it->coroutine);
+          it = waiters_.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+    // Posted without the lock: the executor may resume the coroutine at once,
+    // and it may wait again or fire the machine.
+    for (const auto coroutine : ready)
+    {
+      actions_.post([coroutine]{ coroutine.resume(); });
+    }
+  }
+
+  TStateMachine& sm_;
+  strand actions_;
+  TTransitionAction on_transition_;
+
+  /// Guards waiters_.
+  std::mutex mutex_;
+  std::vector<waiter> waiters_;
+};
+
+}
+
+#endif // STATELESS_COROUTINE_HPP
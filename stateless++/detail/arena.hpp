@@ -0,0 +1,109 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_DETAIL_ARENA_HPP
+#define STATELESS_DETAIL_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * Owner of the objects that make up a state machine configuration.
+ *
+ * Objects are constructed contiguously in large blocks and live until the
+ * arena is destroyed, at which point they are destroyed in reverse order
+ * of creation. Handles to them are plain pointers.
+ */
+class arena
+{
+public:
+  arena()
+    : blocks_()
+    , used_(block_size)
+    , capacity_(block_size)
+    , objects_()
+  {}
+
+  ~arena()
+  {
+    for (auto it = objects_.rbegin(); it != objects_.rend(); ++it)
+    {
+      it->second(it->first);
+    }
+  }
+
+  /// Construct an object in the arena.
+  template<typename T, typename... TArgs>
+  T* create(TArgs&&... args)
+  {
+    static_assert(
+      alignof(T) <= alignof(std::max_align_t),
+      "Over-aligned types cannot be created in the arena.");
+    objects_.reserve(objects_.size() + 1);
+    auto object = new (allocate(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+    objects_.push_back(std::make_pair(static_cast<void*>(object), &destroy<T>));
+    return object;
+  }
+
+private:
+  arena(const arena&);
+  arena& operator=(const arena&);
+
+  static const std::size_t block_size = 4096;
+
+  typedef void (*TDestructor)(void*);
+
+  template<typename T>
+  static void destroy(void* object)
+  {
+    static_cast<T*>(object)->~T();
+  }
+
+  void* allocate(std::size_t size, std::size_t alignment)
+  {
+    // Blocks are suitably aligned for any fundamental type.
+    auto offset = (used_ + alignment - 1) & ~(alignment - 1);
+    if (offset + size > capacity_)
+    {
+      capacity_ = size > block_size ? size : block_size;
+      blocks_.emplace_back(new char[capacity_]);
+      offset = 0;
+    }
+    used_ = offset + size;
+    return blocks_.back().get() + offset;
+  }
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::size_t used_;
+  std::size_t capacity_;
+  std::vector<std::pair<void*, TDestructor>> objects_;
+};
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_ARENA_HPP
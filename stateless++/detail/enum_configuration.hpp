@@ -0,0 +1,251 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATELESS_DETAIL_ENUM_CONFIGURATION_HPP
+#define STATELESS_DETAIL_ENUM_CONFIGURATION_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "../error.hpp"
+#include "../state_configuration.hpp"
+#include "../trigger_with_parameters.hpp"
+#include "arena.hpp"
+#include "state_representation.hpp"
+#include "transition_core.hpp"
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * The configured states and trigger parameters of a machine over enumerated
+ * states, indexed by enumerator value. Shared by enum_state_machine and
+ * enum_state_machine_pool, which differ only in where the current state is
+ * kept.
+ *
+ * Serves as the table of try_fire(): the candidate behaviours of each state
+ * and trigger are found in a dense states x triggers table, so firing a
+ * trigger performs no searching.
+ */
+template<typename TState, typename TTrigger, std::size_t NStates, std::size_t NTriggers>
+class enum_configuration
+{
+public:
+  typedef state_representation<TState, TTrigger> TStateRepresentation;
+  typedef typename TStateRepresentation::TBehaviour TBehaviour;
+  typedef typename TStateRepresentation::TTriggerBehaviourList TTriggerBehaviourList;
+  typedef selected_behaviour<TStateRepresentation> TSelectedBehaviour;
+  typedef state_configuration<TState, TTrigger> TStateConfiguration;
+  typedef typename TStateConfiguration::TTriggerWithParameters TTriggerWithParameters;
+  typedef abstract_trigger_with_parameters<TTrigger> TAbstractTriggerWithParameters;
+
+  enum_configuration()
+    : arena_()
+    , representations_()
+    , handlers_()
+    , trigger_configuration_()
+  {
+    for (std::size_t s = 0; s < NStates; ++s)
+    {
+      auto representation =
+        arena_.create<TStateRepresentation>(static_cast<TState>(s), arena_);
+      representations_[s] = representation;
+      for (std::size_t t = 0; t < NTriggers; ++t)
+      {
+        handlers_[s * NTriggers + t] =
+          &representation->reserve_trigger_behaviours(static_cast<TTrigger>(t));
+      }
+    }
+  }
+
+  enum_configuration(const enum_configuration&) = delete;
+  enum_configuration& operator=(const enum_configuration&) = delete;
+
+  /// The index of an enumerator.
+  template<typename TEnum>
+  static std::size_t index(const TEnum& value)
+  {
+    return static_cast<std::size_t>(value);
+  }
+
+  /// Begin configuration of a state. The owner checks that it is not frozen.
+  TStateConfiguration configure(const TState& state)
+  {
+    using namespace std::placeholders;
+    typedef enum_configuration<TState, TTrigger, NStates, NTriggers> TSelf;
+    return TStateConfiguration(
+      get_representation(state),
+      std::bind(&TSelf::get_representation, this, _1),
+      arena_);
+  }
+
+  /// Specify the arguments that must be supplied when a trigger is fired.
+  template<typename... TArgs>
+  std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>
+  set_trigger_parameters(const TTrigger& trigger)
+  {
+    auto& slot = trigger_configuration_.at(index(trigger));
+    if (slot != nullptr)
+    {
+      raise_error("Cannot reconfigure trigger parameters");
+    }
+    auto configuration =
+      std::make_shared<trigger_with_parameters<TTrigger, TArgs...>>(trigger);
+    slot = configuration;
+    return configuration;
+  }
+
+  /**
+   * Get the representation of a state.
+   *
+   * \throw error The state is outside the range of the state machine.
+   */
+  TStateRepresentation* get_representation(const TState& state) const
+  {
+    const auto s = index(state);
+    if (s >= NStates)
+    {
+      raise_error("The state is outside the range of the state machine.");
+    }
+    return representations_[s];
+  }
+
+  /// Get the representation of a state given its index, which must be in range.
+  const TStateRepresentation* representation(std::size_t s) const
+  {
+    return representations_[s];
+  }
+
+  /// The behaviours configured directly on a state for a trigger, given their indices.
+  const TTriggerBehaviourList& candidates(std::size_t s, std::size_t t) const
+  {
+    return *handlers_[s * NTriggers + t];
+  }
+
+  /// Find the representation of a destination state.
+  const TStateRepresentation* find_representation(const TState& state) const
+  {
+    return get_representation(state);
+  }
+
+  /// Identify a trigger by its enumerator value.
+  std::size_t trigger_key(
+    const TStateRepresentation* representation, const TTrigger& trigger) const
+  {
+    return index(trigger);
+  }
+
+  /// The parameter configuration of a trigger, or nullptr if it has none.
+  const TAbstractTriggerWithParameters* trigger_parameters(
+    const TTrigger& trigger, std::size_t key) const
+  {
+    return key < NTriggers ? trigger_configuration_[key].get() : nullptr;
+  }
+
+  /**
+   * Find the behaviour that handles a trigger in a state or its nearest
+   * superstate that handles it, setting conflict when more than one guard
+   * condition is met.
+   */
+  TSelectedBehaviour find_handler(
+    const TStateRepresentation* representation,
+    const TTrigger& trigger,
+    std::size_t key,
+    bool& conflict) const
+  {
+    TSelectedBehaviour selected = { nullptr, nullptr, false };
+    if (key >= NTriggers)
+    {
+      return selected;
+    }
+    for (; representation != nullptr;
+         representation = representation->super_state_representation())
+    {
+      const auto& list = candidates(index(representation->underlying_state()), key);
+      if (!list.empty())
+      {
+        selected.behaviour = TStateRepresentation::select_handler(list, conflict);
+        if (selected.behaviour != nullptr || conflict)
+        {
+          break;
+        }
+      }
+    }
+    return selected;
+  }
+
+  /**
+   * Find the behaviour that handles a trigger in a state.
+   *
+   * \throw error More than one guard condition is met.
+   */
+  const TBehaviour* find_handler(
+    const TStateRepresentation* representation, const TTrigger& trigger) const
+  {
+    bool conflict = false;
+    const auto selected = find_handler(
+      representation, trigger, trigger_key(representation, trigger), conflict);
+    if (conflict)
+    {
+      TStateRepresentation::raise_guard_conflict();
+    }
+    return selected.behaviour;
+  }
+
+  /// Fill a bitset, indexed by trigger value, with the triggers permitted in a state.
+  void permitted_trigger_mask(
+    const TStateRepresentation* representation, std::bitset<NTriggers>& mask) const
+  {
+    mask.reset();
+    for (; representation != nullptr;
+         representation = representation->super_state_representation())
+    {
+      const auto row = &handlers_[index(representation->underlying_state()) * NTriggers];
+      for (std::size_t t = 0; t < NTriggers; ++t)
+      {
+        if (!mask[t] && TStateRepresentation::is_permitted(*row[t]))
+        {
+          mask.set(t);
+        }
+      }
+    }
+  }
+
+private:
+  /// Owner of the representations, trigger behaviours and entry actions.
+  arena arena_;
+
+  /// Representation of each state, indexed by state value.
+  std::array<TStateRepresentation*, NStates> representations_;
+
+  /// Candidate behaviours, indexed by state value * NTriggers + trigger value.
+  std::array<const TTriggerBehaviourList*, NStates * NTriggers> handlers_;
+
+  /// Parameter configuration of each trigger, indexed by trigger value.
+  std::array<TTriggerWithParameters, NTriggers> trigger_configuration_;
+};
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_ENUM_CONFIGURATION_HPP
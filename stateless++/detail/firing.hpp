@@ -0,0 +1,152 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATELESS_DETAIL_FIRING_HPP
+#define STATELESS_DETAIL_FIRING_HPP
+
+#include <cstddef>
+
+#include "../error.hpp"
+#include "../fire_result.hpp"
+#include "state_representation.hpp"
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * The default unhandled trigger action of every machine: raise an error.
+ */
+template<typename TState, typename TTrigger>
+void raise_unhandled_trigger(const TState&, const TTrigger&)
+{
+  raise_error(
+    "No valid leaving transitions are permitted for trigger. "
+    "Consider ignoring the trigger.");
+}
+
+/**
+ * Report the outcome of try_fire() as fire() does: an unhandled trigger is
+ * passed to the unhandled trigger action, and guard conflicts and bad
+ * parameters raise an error.
+ *
+ * \param result The outcome of try_fire().
+ * \param representation The state the trigger was fired in.
+ * \param trigger The trigger.
+ * \param on_unhandled_trigger The unhandled trigger action.
+ *
+ * \return The outcome, which is unhandled only if the action returned.
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy,
+  typename TUnhandledTriggerAction>
+fire_result raise_fire_error(
+  fire_result result,
+  const state_representation<TState, TTrigger, TContainerPolicy>* representation,
+  const TTrigger& trigger,
+  const TUnhandledTriggerAction& on_unhandled_trigger)
+{
+  switch (result)
+  {
+  case fire_result::unhandled:
+    on_unhandled_trigger(representation->underlying_state(), trigger);
+    break;
+  case fire_result::guard_conflict:
+    state_representation<TState, TTrigger, TContainerPolicy>::raise_guard_conflict();
+    break;
+  case fire_result::bad_parameters:
+    raise_error("Invalid number or type of parameters.");
+  default:
+    break;
+  }
+  return result;
+}
+
+/**
+ * Add the outcome of one trigger of a batch to its result.
+ *
+ * \return False if the batch must stop.
+ */
+inline bool record_batch_outcome(
+  batch_result& result, fire_result outcome, batch_policy policy)
+{
+  result.last_result = outcome;
+  ++result.consumed;
+  if (!is_handled(outcome))
+  {
+    ++result.failed;
+    return policy != batch_policy::stop_on_failure;
+  }
+  return true;
+}
+
+/**
+ * Fire a sequence of triggers in order, as by fire_all().
+ *
+ * \param fire Fires one trigger, returning the outcome as by try_fire().
+ */
+template<typename TInputIterator, typename TFire>
+batch_result fire_sequence(
+  TInputIterator first, TInputIterator last, batch_policy policy, TFire fire)
+{
+  batch_result result = { 0, 0, fire_result::ignored };
+  for (; first != last; ++first)
+  {
+    if (!record_batch_outcome(result, fire(*first), policy))
+    {
+      break;
+    }
+  }
+  return result;
+}
+
+/**
+ * Fire queued triggers in the order they were queued, removing each from
+ * the queue once it has been fired, so that a trigger whose firing raises an
+ * error stays queued. Only the consumer of the queue may call this.
+ *
+ * \param queue The queue, with front() and pop() as lazy_mpsc_queue.
+ * \param max_triggers The maximum number of triggers to fire.
+ * \param fire Fires one trigger.
+ *
+ * \return The number of triggers fired.
+ */
+template<typename TQueue, typename TFire>
+std::size_t drain_queue(TQueue& queue, std::size_t max_triggers, TFire fire)
+{
+  std::size_t fired = 0;
+  for (; fired < max_triggers; ++fired)
+  {
+    const auto trigger = queue.front();
+    if (trigger == nullptr)
+    {
+      break;
+    }
+    fire(*trigger);
+    queue.pop();
+  }
+  return fired;
+}
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_FIRING_HPP
@@ -0,0 +1,108 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_DETAIL_FLAT_MAP_HPP
+#define STATELESS_DETAIL_FLAT_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * Associative container that keeps its entries sorted by key in a single
+ * contiguous vector.
+ *
+ * Lookups are binary searches over contiguous memory. Insertions shift the
+ * entries that follow, and so invalidate iterators and references to them.
+ */
+template<typename TKey, typename TValue>
+class flat_map
+{
+public:
+  typedef TKey key_type;
+  typedef TValue mapped_type;
+  typedef std::pair<TKey, TValue> value_type;
+  typedef typename std::vector<value_type>::iterator iterator;
+  typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  std::size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  void clear() { entries_.clear(); }
+
+  iterator find(const TKey& key)
+  {
+    auto it = lower_bound(key);
+    return (it != entries_.end() && !(key < it->first)) ? it : entries_.end();
+  }
+
+  const_iterator find(const TKey& key) const
+  {
+    auto it = lower_bound(key);
+    return (it != entries_.end() && !(key < it->first)) ? it : entries_.end();
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value)
+  {
+    auto it = lower_bound(value.first);
+    if (it != entries_.end() && !(value.first < it->first))
+    {
+      return std::make_pair(it, false);
+    }
+    return std::make_pair(entries_.insert(it, value), true);
+  }
+
+  TValue& operator[](const TKey& key)
+  {
+    return insert(value_type(key, TValue())).first->second;
+  }
+
+private:
+  static bool key_less(const value_type& entry, const TKey& key)
+  {
+    return entry.first < key;
+  }
+
+  iterator lower_bound(const TKey& key)
+  {
+    return std::lower_bound(entries_.begin(), entries_.end(), key, &key_less);
+  }
+
+  const_iterator lower_bound(const TKey& key) const
+  {
+    return std::lower_bound(entries_.begin(), entries_.end(), key, &key_less);
+  }
+
+  std::vector<value_type> entries_;
+};
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_FLAT_MAP_HPP
@@ -0,0 +1,248 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATELESS_DETAIL_MACHINE_CONFIGURATION_HPP
+#define STATELESS_DETAIL_MACHINE_CONFIGURATION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "../container_policy.hpp"
+#include "../error.hpp"
+#include "../state_configuration.hpp"
+#include "../trigger_with_parameters.hpp"
+#include "arena.hpp"
+#include "state_representation.hpp"
+#include "state_table.hpp"
+#include "transition_core.hpp"
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * The configured states and trigger parameters of a machine, and the table
+ * compiled from them by freeze(). Shared by state_machine and
+ * machine_definition, which differ only in where the current state is kept.
+ *
+ * Serves as the table of try_fire(): before freeze() behaviours are found by
+ * searching the configuration, afterwards through the compiled table.
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class machine_configuration
+{
+public:
+  typedef state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
+  typedef state_table<TState, TTrigger, TContainerPolicy> TStateTable;
+  typedef typename TStateRepresentation::TBehaviour TBehaviour;
+  typedef selected_behaviour<TStateRepresentation> TSelectedBehaviour;
+  typedef state_configuration<TState, TTrigger, TContainerPolicy> TStateConfiguration;
+  typedef typename TStateConfiguration::TTriggerWithParameters TTriggerWithParameters;
+  typedef abstract_trigger_with_parameters<TTrigger> TAbstractTriggerWithParameters;
+
+  machine_configuration()
+    : arena_()
+    , state_configuration_()
+    , trigger_configuration_()
+    , table_()
+    , frozen_(false)
+  {}
+
+  machine_configuration(const machine_configuration&) = delete;
+  machine_configuration& operator=(const machine_configuration&) = delete;
+
+  /// Begin configuration of a state. The owner checks that it is not frozen.
+  TStateConfiguration configure(const TState& state)
+  {
+    using namespace std::placeholders;
+    typedef machine_configuration<TState, TTrigger, TContainerPolicy> TSelf;
+    return TStateConfiguration(
+      get_representation(state),
+      std::bind(&TSelf::get_representation, this, _1),
+      arena_);
+  }
+
+  /// Specify the arguments that must be supplied when a trigger is fired.
+  template<typename... TArgs>
+  std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>
+  set_trigger_parameters(const TTrigger& trigger)
+  {
+    auto it = trigger_configuration_.find(trigger);
+    if (it != trigger_configuration_.end())
+    {
+      raise_error("Cannot reconfigure trigger parameters");
+    }
+    auto configuration =
+      std::make_shared<trigger_with_parameters<TTrigger, TArgs...>>(trigger);
+    trigger_configuration_[trigger] = configuration;
+    return configuration;
+  }
+
+  /// Compile the table; the configuration is read-only afterwards.
+  void freeze()
+  {
+    table_.compile(state_configuration_, trigger_configuration_);
+    frozen_ = true;
+  }
+
+  /// Whether the table has been compiled.
+  bool is_frozen() const
+  {
+    return frozen_;
+  }
+
+  /// The compiled table.
+  const TStateTable& table() const
+  {
+    return table_;
+  }
+
+  /// Get the representation of a state, creating it if it is not configured.
+  TStateRepresentation* get_representation(const TState& state) const
+  {
+    auto it = state_configuration_.find(state);
+    if (it == state_configuration_.end())
+    {
+      auto representation = arena_.create<TStateRepresentation>(state, arena_);
+      state_configuration_.insert(std::make_pair(state, representation));
+      return representation;
+    }
+    return it->second;
+  }
+
+  /**
+   * Find the representation of a state. Once frozen only the compiled table
+   * is searched, so nothing is created and unknown states raise an error.
+   */
+  const TStateRepresentation* find_representation(const TState& state) const
+  {
+    if (frozen_)
+    {
+      const auto id = table_.state_id(state);
+      if (id == TStateTable::npos)
+      {
+        raise_error("The state is not configured in the frozen state machine.");
+      }
+      return table_.representation(id);
+    }
+    return get_representation(state);
+  }
+
+  /// Identify a trigger fired in a state; npos before freeze().
+  std::size_t trigger_key(
+    const TStateRepresentation* representation, const TTrigger& trigger) const
+  {
+    return frozen_ ? table_.trigger_id(representation->id(), trigger) : TStateTable::npos;
+  }
+
+  /// The parameter configuration of a trigger, or nullptr if it has none.
+  const TAbstractTriggerWithParameters* trigger_parameters(
+    const TTrigger& trigger, std::size_t key) const
+  {
+    if (frozen_)
+    {
+      return table_.trigger_parameters(key);
+    }
+    auto it = trigger_configuration_.find(trigger);
+    return it == trigger_configuration_.end() ? nullptr : it->second.get();
+  }
+
+  /**
+   * Find the behaviour that handles a trigger in a state, setting conflict
+   * when more than one guard condition is met.
+   */
+  TSelectedBehaviour find_handler(
+    const TStateRepresentation* representation,
+    const TTrigger& trigger,
+    std::size_t key,
+    bool& conflict) const
+  {
+    if (frozen_)
+    {
+      const auto compiled = table_.try_find_handler(representation->id(), key, conflict);
+      if (compiled != nullptr)
+      {
+        const TSelectedBehaviour selected =
+          { compiled->behaviour, compiled->destination, compiled->fixed };
+        return selected;
+      }
+      const TSelectedBehaviour none = { nullptr, nullptr, false };
+      return none;
+    }
+    const TSelectedBehaviour selected =
+      { representation->try_find_handler(trigger, conflict), nullptr, false };
+    return selected;
+  }
+
+  /**
+   * Find the behaviour that handles a trigger in a state.
+   *
+   * \throw error More than one guard condition is met.
+   */
+  const TBehaviour* find_handler(
+    const TStateRepresentation* representation, const TTrigger& trigger) const
+  {
+    bool conflict = false;
+    const auto selected = find_handler(
+      representation, trigger, trigger_key(representation, trigger), conflict);
+    if (conflict)
+    {
+      TStateRepresentation::raise_guard_conflict();
+    }
+    return selected.behaviour;
+  }
+
+private:
+  /// Mapping from state to representation.
+  typedef typename TContainerPolicy::template map<
+    TState, TStateRepresentation*>::type TStateMap;
+
+  /// Mapping from trigger to parameter configuration.
+  typedef typename TContainerPolicy::template map<
+    TTrigger, TTriggerWithParameters>::type TTriggerMap;
+
+  /// Owner of the representations, trigger behaviours and entry actions of all states.
+  mutable arena arena_;
+
+  /**
+   * Mapping from state to representation.
+   * There is exactly one representation per configured state,
+   * owned by the arena so that its address never changes.
+   */
+  mutable TStateMap state_configuration_;
+
+  /// Mapping of triggers with arguments to the underlying trigger.
+  TTriggerMap trigger_configuration_;
+
+  /// Transition table compiled by freeze().
+  TStateTable table_;
+
+  /// Whether configuration is finished and the table is in use.
+  bool frozen_;
+};
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_MACHINE_CONFIGURATION_HPP
@@ -0,0 +1,308 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_DETAIL_MPSC_QUEUE_HPP
+#define STATELESS_DETAIL_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../error.hpp"
+
+/// Capacity of the queue of deferred triggers of a state machine, a power of two.
+#ifndef STATELESS_DEFERRED_TRIGGER_CAPACITY
+#define STATELESS_DEFERRED_TRIGGER_CAPACITY 256
+#endif
+
+namespace stateless
+{
+
+namespace detail
+{
+
+static_assert(
+  STATELESS_DEFERRED_TRIGGER_CAPACITY > 0 &&
+  (STATELESS_DEFERRED_TRIGGER_CAPACITY & (STATELESS_DEFERRED_TRIGGER_CAPACITY - 1)) == 0,
+  "STATELESS_DEFERRED_TRIGGER_CAPACITY must be a power of two.");
+
+/**
+ * Bounded lock-free queue with any number of producers and a single consumer.
+ *
+ * Every slot of the ring buffer carries a sequence number telling producers
+ * and the consumer whose turn it is to use it, so pushing and popping never
+ * block or allocate. Values are constructed in place when pushed and
+ * destroyed when popped, so T need not be default constructible. The
+ * consumer must be a single thread at a time.
+ *
+ * A slot must be published once claimed, or the consumer would wait for it
+ * forever. If copying a pushed value throws, its slot is published empty
+ * and skipped by the consumer.
+ */
+template<typename T>
+class mpsc_queue
+{
+public:
+  /**
+   * \param capacity Maximum number of queued values, a power of two.
+   */
+  explicit mpsc_queue(std::size_t capacity)
+    : cells_(new cell[capacity])
+    , mask_(capacity - 1)
+    , enqueue_position_(0)
+    , dequeue_position_(0)
+  {
+    for (std::size_t i = 0; i < capacity; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpsc_queue(const mpsc_queue&) = delete;
+  mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+  /// Destroy the values that were never popped.
+  ~mpsc_queue()
+  {
+    while (front() != nullptr)
+    {
+      pop();
+    }
+  }
+
+  /**
+   * Append a value. May be called from any thread.
+   *
+   * \return False if the queue is full, in which case the value is dropped.
+   */
+  bool push(const T& value)
+  {
+    auto position = enqueue_position_.load(std::memory_order_relaxed);
+    cell* c;
+    for (;;)
+    {
+      c = &cells_[position & mask_];
+      const auto sequence = c->sequence.load(std::memory_order_acquire);
+      const auto difference =
+        static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+      if (difference == 0)
+      {
+        if (enqueue_position_.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false;
+      }
+      else
+      {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+#ifndef STATELESS_NO_EXCEPTIONS
+    try
+    {
+#endif
+      new (&c->storage) T(value);
+#ifndef STATELESS_NO_EXCEPTIONS
+    }
+    catch (...)
+    {
+      c->filled = false;
+      c->sequence.store(position + 1, std::memory_order_release);
+      throw;
+    }
+#endif
+    c->filled = true;
+    c->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * The oldest value, left in the queue. Must only be called by the consumer.
+   *
+   * \return The value, or nullptr if the queue is empty.
+   */
+  T* front()
+  {
+    for (;;)
+    {
+      auto& c = cells_[dequeue_position_ & mask_];
+      if (c.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1)
+      {
+        return nullptr;
+      }
+      if (c.filled)
+      {
+        return c.value();
+      }
+      // Skip the slot of a value whose copy threw.
+      c.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+      ++dequeue_position_;
+    }
+  }
+
+  /**
+   * Destroy the oldest value. Must only be called by the consumer,
+   * after front() has returned a value.
+   */
+  void pop()
+  {
+    auto& c = cells_[dequeue_position_ & mask_];
+    c.value()->~T();
+    c.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_position_;
+  }
+
+  /**
+   * Remove the oldest value. Must only be called by the consumer.
+   *
+   * \return False if the queue is empty.
+   */
+  bool pop(T& value)
+  {
+    const auto oldest = front();
+    if (oldest == nullptr)
+    {
+      return false;
+    }
+    value = std::move(*oldest);
+    pop();
+    return true;
+  }
+
+  /// Maximum number of queued values.
+  std::size_t capacity() const
+  {
+    return mask_ + 1;
+  }
+
+private:
+  static const std::size_t cache_line_size = 64;
+
+  struct cell
+  {
+    cell()
+      : sequence(0)
+      , filled(false)
+    {}
+
+    T* value()
+    {
+      return reinterpret_cast<T*>(&storage);
+    }
+
+    std::atomic<std::size_t> sequence;
+
+    /// Whether storage holds a value; written before sequence is published.
+    bool filled;
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  std::unique_ptr<cell[]> cells_;
+  const std::size_t mask_;
+
+  // Keep the producer and consumer positions on separate cache lines.
+  char padding0_[cache_line_size];
+  std::atomic<std::size_t> enqueue_position_;
+  char padding1_[cache_line_size];
+  std::size_t dequeue_position_;
+};
+
+/**
+ * An mpsc_queue that is only allocated when the first value is pushed, so
+ * owners that never queue anything pay for a single pointer.
+ */
+template<typename T>
+class lazy_mpsc_queue
+{
+public:
+  /**
+   * \param capacity Maximum number of queued values, a power of two.
+   */
+  explicit lazy_mpsc_queue(std::size_t capacity)
+    : queue_(nullptr)
+    , capacity_(capacity)
+  {}
+
+  lazy_mpsc_queue(const lazy_mpsc_queue&) = delete;
+  lazy_mpsc_queue& operator=(const lazy_mpsc_queue&) = delete;
+
+  ~lazy_mpsc_queue()
+  {
+    delete queue_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Append a value. May be called from any thread. The first push allocates
+   * the queue; when producers race to do so, all but one discard theirs.
+   *
+   * \return False if the queue is full, in which case the value is dropped.
+   */
+  bool push(const T& value)
+  {
+    auto queue = queue_.load(std::memory_order_acquire);
+    if (queue == nullptr)
+    {
+      std::unique_ptr<mpsc_queue<T>> created(new mpsc_queue<T>(capacity_));
+      if (queue_.compare_exchange_strong(
+            queue, created.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        queue = created.release();
+      }
+    }
+    return queue->push(value);
+  }
+
+  /**
+   * The oldest value, left in the queue. Must only be called by the consumer.
+   *
+   * \return The value, or nullptr if the queue is empty.
+   */
+  T* front()
+  {
+    const auto queue = queue_.load(std::memory_order_acquire);
+    return queue == nullptr ? nullptr : queue->front();
+  }
+
+  /**
+   * Destroy the oldest value. Must only be called by the consumer,
+   * after front() has returned a value.
+   */
+  void pop()
+  {
+    queue_.load(std::memory_order_relaxed)->pop();
+  }
+
+private:
+  std::atomic<mpsc_queue<T>*> queue_;
+  const std::size_t capacity_;
+};
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_MPSC_QUEUE_HPP
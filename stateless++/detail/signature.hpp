@@ -14,8 +14,9 @@
  * limitations under the License.
  */
 
-#ifndef STATELESS_DETAIL_NO_GUARD_HPP
-#define STATELESS_DETAIL_NO_GUARD_HPP
+
+#ifndef STATELESS_DETAIL_SIGNATURE_HPP
+#define STATELESS_DETAIL_SIGNATURE_HPP
 
 namespace stateless
 {
@@ -23,14 +24,32 @@ namespace stateless
 namespace detail
 {
 
-/// Convenience function for no-op guard clause.
-inline bool no_guard()
+/// Opaque identifier of a list of trigger argument types.
+typedef const void* signature_id;
+
+/**
+ * Provides a unique identifier for each list of trigger argument types.
+ *
+ * Used to match parameterized triggers with the behaviours and entry actions
+ * configured for them without resorting to RTTI.
+ */
+template<typename... TArgs>
+struct signature
 {
-  return true;
-}
+  static signature_id id()
+  {
+    return &tag;
+  }
+
+private:
+  static const char tag;
+};
+
+template<typename... TArgs>
+const char signature<TArgs...>::tag = 0;
 
 }
 
 }
 
-#endif // STATELESS_DETAIL_NO_GUARD_HPP
+#endif // STATELESS_DETAIL_SIGNATURE_HPP
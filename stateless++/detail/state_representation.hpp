@@ -18,6 +18,7 @@
 #define STATELESS_DETAIL_STATE_REPRESENTATION_HPP
 
 #include <algorithm>
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <set>
@@ -25,7 +26,11 @@
 #include <type_traits>
 #include <vector>
 
+#include "../container_policy.hpp"
 #include "../error.hpp"
+#include "../inplace_function.hpp"
+#include "arena.hpp"
+#include "signature.hpp"
 #include "transition.hpp"
 #include "trigger_behaviour.hpp"
 
@@ -38,7 +43,20 @@ namespace detail
 class abstract_entry_action
 {
 public:
+  abstract_entry_action(signature_id signature)
+    : signature_(signature)
+  {}
+
   virtual ~abstract_entry_action() = 0;
+
+  /// Identifies the argument types the action accepts.
+  signature_id signature() const
+  {
+    return signature_;
+  }
+
+private:
+  const signature_id signature_;
 };
 
 inline abstract_entry_action::~abstract_entry_action()
@@ -47,72 +65,110 @@ inline abstract_entry_action::~abstract_entry_action()
 template<typename TTransition, typename... TArgs>
 struct entry_action : public abstract_entry_action
 {
-  entry_action(const std::function<void(const TTransition&, TArgs...)>& action)
-    : execute(action)
+  typedef inplace_function<void(const TTransition&, const TArgs&...)> TAction;
+
+  entry_action(const TAction& action)
+    : abstract_entry_action(detail::signature<TArgs...>::id())
+    , execute(action)
   {}
   
-  std::function<void(const TTransition&, TArgs...)> execute;
+  TAction execute;
 };
   
-template<typename TState, typename TTrigger>
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
 class state_representation
 {
 public:
   typedef transition<TState, TTrigger> TTransition;
-  typedef std::shared_ptr<abstract_trigger_behaviour> TTriggerBehaviour;
-  typedef std::shared_ptr<abstract_entry_action> TEntryAction;
-  typedef std::function<void(const TTransition&)> TExitAction;
-
-  state_representation(const TState& state)
+  typedef trigger_behaviour<TState, TTrigger> TBehaviour;
+  typedef const TBehaviour* TTriggerBehaviour;
+  typedef const abstract_entry_action* TEntryAction;
+  typedef inplace_function<void(const TTransition&)> TExitAction;
+  typedef std::vector<TTriggerBehaviour> TTriggerBehaviourList;
+  typedef typename TContainerPolicy::template map<
+    TTrigger, TTriggerBehaviourList>::type TTriggerBehaviourMap;
+
+  /// Identifier of a representation that has not been compiled into a table.
+  static const std::size_t npos = static_cast<std::size_t>(-1);
+
+  /**
+   * Construct a representation of a state.
+   *
+   * \param state The underlying state.
+   * \param arena Owner of the entry actions created by the representation.
+   */
+  state_representation(const TState& state, arena& arena)
     : state_(state)
+    , id_(npos)
+    , arena_(&arena)
     , trigger_behaviours_()
     , entry_actions_()
     , exit_actions_()
     , super_state_(nullptr)
     , sub_states_()
+    , ancestors_(1, this)
   {}
 
+  state_representation(const state_representation&) = delete;
+  state_representation& operator=(const state_representation&) = delete;
+
   bool can_handle(const TTrigger& trigger) const
   {
     return try_find_handler(trigger) != nullptr;
   }
 
-  const TTriggerBehaviour try_find_handler(const TTrigger& trigger) const
+  const TBehaviour* try_find_handler(const TTrigger& trigger) const
   {
-    auto handler = try_find_local_hander(trigger);
-    if (handler == nullptr && super_state_ != nullptr)
+    bool conflict = false;
+    auto handler = try_find_handler(trigger, conflict);
+    if (conflict)
     {
-      handler = super_state_->try_find_handler(trigger);
+      raise_guard_conflict();
     }
     return handler;
   }
 
+  /**
+   * Find the behaviour that handles a trigger in this state or its superstates.
+   *
+   * \param trigger The trigger.
+   * \param conflict Set when more than one candidate has its guard condition met,
+   *                 in which case no behaviour is returned.
+   */
+  const TBehaviour* try_find_handler(const TTrigger& trigger, bool& conflict) const
+  {
+    for (auto representation = this;
+         representation != nullptr;
+         representation = representation->super_state_)
+    {
+      const auto& candidates = representation->trigger_behaviours_.find(trigger);
+      if (candidates != representation->trigger_behaviours_.end())
+      {
+        auto handler = select_handler(candidates->second, conflict);
+        if (handler != nullptr || conflict)
+        {
+          return handler;
+        }
+      }
+    }
+    return nullptr;
+  }
+
   template<typename TCallable, typename... TArgs>
   void add_entry_action(TCallable action)
   {
-    auto ea = std::make_shared<entry_action<TTransition, TArgs...>>(action);
-    entry_actions_.push_back(ea);
+    auto ea = arena_->create<entry_action<TTransition, TArgs...>>(action);
+    entry_actions_.push_back(entry_action_binding(ea));
   }
 
   template<typename TCallable, typename... TArgs>
   void add_entry_action(const TTrigger& trigger, TCallable action)
   {
-    auto wrapper =
-      [=](const TTransition& transition, TArgs... args)
-      {
-        if (transition.trigger() == trigger)
-        {
-#if _WIN32
-          // Workaround for error C3849 http://msdn.microsoft.com/en-us/library/031k84se.aspx
-          typedef typename std::remove_cv<TCallable>::type TCVRemoved;
-          ((TCVRemoved)(action))(transition, args...);
-#else
-          action(transition, args...);
-#endif
-        }
-      };
-    auto ea = std::make_shared<entry_action<TTransition, TArgs...>>(wrapper);
-    entry_actions_.push_back(ea);
+    auto ea = arena_->create<entry_action<TTransition, TArgs...>>(action);
+    entry_actions_.push_back(entry_action_binding(ea, trigger));
   }
 
   void add_exit_action(const TExitAction& exit_action)
@@ -120,40 +176,67 @@ public:
     exit_actions_.push_back(exit_action);
   }
 
+  /**
+   * Execute the entry actions of the states entered by a transition into this
+   * state, from the outermost entered superstate down to this state.
+   *
+   * \param transition The transition.
+   * \param source The representation of the source state, or nullptr if the
+   *               source is not in the hierarchy of this state.
+   * \param args The arguments passed in the transition.
+   */
   template<typename... TArgs>
-  void enter(const TTransition& transition, TArgs... args) const
+  void enter_from(
+    const TTransition& transition,
+    const state_representation* source,
+    const TArgs&... args) const
   {
     if (transition.is_reentry())
     {
       execute_entry_actions(transition, args...);
+      return;
     }
-    else if (!includes(transition.source()))
+    for (auto i = common_ancestors(source); i < ancestors_.size(); ++i)
     {
-      if (super_state_ != nullptr)
-      {
-        super_state_->enter(transition, args...);
-      }
-      execute_entry_actions(transition, args...);
+      ancestors_[i]->execute_entry_actions(transition, args...);
     }
   }
 
-  void exit(const TTransition& transition) const
+  /**
+   * Execute the exit actions of the states left by a transition from this
+   * state, from this state up to the outermost superstate that is left.
+   *
+   * \param transition The transition.
+   * \param destination The representation of the destination state, or nullptr
+   *                    if the destination is not in the hierarchy of this state.
+   */
+  void exit_to(const TTransition& transition, const state_representation* destination) const
   {
     if (transition.is_reentry())
     {
       execute_exit_actions(transition);
+      return;
     }
-    else if (!includes(transition.destination()))
+    for (auto i = ancestors_.size(); i > common_ancestors(destination); --i)
     {
-      execute_exit_actions(transition);
-      if (super_state_ != nullptr)
-      {
-        super_state_->exit(transition);
-      }
+      ancestors_[i - 1]->execute_exit_actions(transition);
     }
   }
 
-  void add_trigger_behaviour(const TTrigger& trigger, const TTriggerBehaviour trigger_behaviour)
+  /// Enter this state, looking up the source of the transition in the hierarchy.
+  template<typename... TArgs>
+  void enter(const TTransition& transition, const TArgs&... args) const
+  {
+    enter_from(transition, find_in_hierarchy(transition.source()), args...);
+  }
+
+  /// Exit this state, looking up the destination of the transition in the hierarchy.
+  void exit(const TTransition& transition) const
+  {
+    exit_to(transition, find_in_hierarchy(transition.destination()));
+  }
+
+  void add_trigger_behaviour(const TTrigger& trigger, TTriggerBehaviour trigger_behaviour)
   {
     trigger_behaviours_[trigger].push_back(trigger_behaviour);
   }
@@ -163,9 +246,57 @@ public:
     return *super_state_;
   }
 
+  const state_representation* super_state_representation() const
+  {
+    return super_state_;
+  }
+
+  /**
+   * Set the superstate and recompute the ancestor chains of this state and
+   * of its substates.
+   *
+   * \throw error The superstate is this state or one of its substates.
+   */
   void set_super_state(const state_representation* super_state)
   {
+    if (super_state != nullptr && super_state->is_included_in(state_))
+    {
+      raise_error("A state cannot be a substate of itself or of its substates.");
+    }
     super_state_ = super_state;
+
+    std::vector<state_representation*> pending(1, this);
+    while (!pending.empty())
+    {
+      auto representation = pending.back();
+      pending.pop_back();
+      auto& ancestors = representation->ancestors_;
+      ancestors.clear();
+      if (representation->super_state_ != nullptr)
+      {
+        ancestors = representation->super_state_->ancestors_;
+      }
+      ancestors.push_back(representation);
+      for (const auto sub_state : representation->sub_states_)
+      {
+        if (sub_state->super_state_ == representation)
+        {
+          pending.push_back(sub_state);
+        }
+      }
+    }
+  }
+
+  /// Number of superstates above this state.
+  std::size_t depth() const
+  {
+    return ancestors_.size() - 1;
+  }
+
+  /// The chain of states from the outermost superstate down to this state.
+  const std::vector<const state_representation*>& ancestors() const
+  {
+    return ancestors_;
   }
 
   const TState& underlying_state() const
@@ -173,7 +304,32 @@ public:
     return state_;
   }
 
-  void add_sub_state(const state_representation* sub_state)
+  /// Dense identifier assigned when the owning state machine is frozen.
+  std::size_t id() const
+  {
+    return id_;
+  }
+
+  void set_id(std::size_t id)
+  {
+    id_ = id;
+  }
+
+  const TTriggerBehaviourMap& trigger_behaviours() const
+  {
+    return trigger_behaviours_;
+  }
+
+  /**
+   * Reserve the list of behaviours for a trigger. With node based containers
+   * its address stays valid however the representation is configured afterwards.
+   */
+  const TTriggerBehaviourList& reserve_trigger_behaviours(const TTrigger& trigger)
+  {
+    return trigger_behaviours_[trigger];
+  }
+
+  void add_sub_state(state_representation* sub_state)
   {
     sub_states_.push_back(sub_state);
   }
@@ -196,59 +352,111 @@ public:
 
   bool is_included_in(const TState& state) const
   {
-    return (state == state_ ||
-      (super_state_ != nullptr && super_state_->is_included_in(state)));
+    for (auto representation = this;
+         representation != nullptr;
+         representation = representation->super_state_)
+    {
+      if (representation->state_ == state)
+      {
+        return true;
+      }
+    }
+    return false;
   }
   
   std::set<TTrigger> permitted_triggers() const
   {
-    std::set<TTrigger> local;
-    for (auto& trigger_behaviour_list : trigger_behaviours_)
+    std::set<TTrigger> result;
+    for_each_permitted_trigger([&](const TTrigger& trigger) { result.insert(trigger); });
+    return result;
+  }
+
+  /**
+   * Invoke a visitor with each trigger permitted in this state or inherited
+   * from its superstates. Each trigger is visited once, the triggers of this
+   * state first and those of the outermost superstate last.
+   *
+   * \param visitor Callable accepting a const TTrigger&.
+   */
+  template<typename TVisitor>
+  void for_each_permitted_trigger(TVisitor visitor) const
+  {
+    // Triggers already visited in a substate, which shadow those of the
+    // superstates. Each guard is evaluated at most once.
+    visited_triggers visited;
+    for (auto representation = this;
+         representation != nullptr;
+         representation = representation->super_state_)
     {
-      for (auto& trigger_behaviour : trigger_behaviour_list.second)
+      const bool has_super_state = representation->super_state_ != nullptr;
+      for (const auto& behaviours : representation->trigger_behaviours_)
       {
-        if (trigger_behaviour->is_condition_met())
+        if (!visited.contains(behaviours.first) && is_permitted(behaviours.second))
         {
-          local.insert(trigger_behaviour_list.first);
-          break;
+          visitor(behaviours.first);
+          if (has_super_state)
+          {
+            visited.add(behaviours.first);
+          }
         }
       }
     }
-      
-    if (super_state_ != nullptr)
+  }
+
+  /// Determine whether any of a list of candidates has its guard condition met.
+  static bool is_permitted(const TTriggerBehaviourList& candidates)
+  {
+    for (const auto& candidate : candidates)
     {
-      auto super = super_state_->permitted_triggers();
-      std::set<TTrigger> result;
-      std::set_union(
-        local.begin(), local.end(),
-        super.begin(), super.end(),
-        std::inserter(result, result.begin()));
-      return result;
-    }    
-    return local;
+      if (candidate->is_condition_met())
+      {
+        return true;
+      }
+    }
+    return false;
   }
 
-private:
-  const TTriggerBehaviour try_find_local_hander(const TTrigger& trigger) const
+  /**
+   * Select the single candidate whose guard condition is met.
+   *
+   * \throw error More than one candidate has its guard condition met.
+   */
+  static const TBehaviour* select_handler(const TTriggerBehaviourList& candidates)
   {
-    TTriggerBehaviour result = nullptr;
+    bool conflict = false;
+    auto handler = select_handler(candidates, conflict);
+    if (conflict)
+    {
+      raise_guard_conflict();
+    }
+    return handler;
+  }
 
-    const auto& candidates = trigger_behaviours_.find(trigger);
-    if (candidates == trigger_behaviours_.end())
+  /**
+   * Select the single candidate whose guard condition is met.
+   *
+   * \param candidates The candidates.
+   * \param conflict Set when more than one candidate has its guard condition met,
+   *                 in which case no candidate is selected.
+   */
+  static const TBehaviour* select_handler(
+    const TTriggerBehaviourList& candidates, bool& conflict)
+  {
+    if (candidates.size() == 1 && !candidates.front()->is_guarded())
     {
-      return result;
+      return candidates.front();
     }
 
-    for (const auto& candidate : candidates->second)
+    const TBehaviour* result = nullptr;
+
+    for (const auto& candidate : candidates)
     {
       if (candidate->is_condition_met())
       {
         if (result != nullptr)
-        {           
-          throw error(
-            "Multiple permitted exit transitions are "
-            "configured from the current state. Guard "
-            "clauses must be mutually exclusive.");
+        {
+          conflict = true;
+          return nullptr;
         }
         result = candidate;
       }
@@ -257,14 +465,115 @@ private:
     return result;
   }
 
+  /// Throw the error reported when the guard clauses of a trigger overlap.
+  [[noreturn]] static void raise_guard_conflict()
+  {
+    raise_error(
+      "Multiple permitted exit transitions are "
+      "configured from the current state. Guard "
+      "clauses must be mutually exclusive.");
+  }
+
+private:
+  /**
+   * The triggers visited by for_each_permitted_trigger(). Held inline, so
+   * nothing is allocated unless a hierarchy permits more than
+   * inline_capacity triggers below its outermost superstate.
+   */
+  class visited_triggers
+  {
+  public:
+    visited_triggers()
+      : size_(0)
+      , overflow_()
+    {}
+
+    bool contains(const TTrigger& trigger) const
+    {
+      for (std::size_t i = 0; i < size_; ++i)
+      {
+        if (*inline_[i] == trigger)
+        {
+          return true;
+        }
+      }
+      for (const auto t : overflow_)
+      {
+        if (*t == trigger)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void add(const TTrigger& trigger)
+    {
+      if (size_ < inline_capacity)
+      {
+        inline_[size_++] = &trigger;
+      }
+      else
+      {
+        overflow_.push_back(&trigger);
+      }
+    }
+
+  private:
+    static const std::size_t inline_capacity = 16;
+
+    const TTrigger* inline_[inline_capacity];
+    std::size_t size_;
+    std::vector<const TTrigger*> overflow_;
+  };
+
+  /// Number of leading ancestors shared with another representation.
+  std::size_t common_ancestors(const state_representation* other) const
+  {
+    if (other == nullptr)
+    {
+      return 0;
+    }
+    const auto n = std::min(ancestors_.size(), other->ancestors_.size());
+    std::size_t i = 0;
+    while (i < n && ancestors_[i] == other->ancestors_[i])
+    {
+      ++i;
+    }
+    return i;
+  }
+
+  /// Find the representation of a state in the hierarchy containing this state.
+  const state_representation* find_in_hierarchy(const TState& state) const
+  {
+    std::vector<const state_representation*> pending(1, ancestors_.front());
+    while (!pending.empty())
+    {
+      auto representation = pending.back();
+      pending.pop_back();
+      if (representation->state_ == state)
+      {
+        return representation;
+      }
+      pending.insert(
+        pending.end(),
+        representation->sub_states_.begin(),
+        representation->sub_states_.end());
+    }
+    return nullptr;
+  }
+
   template<typename... TArgs>
-  void execute_entry_actions(const TTransition& transition, TArgs... args) const
+  void execute_entry_actions(const TTransition& transition, const TArgs&... args) const
   {
-    for (auto& action : entry_actions_)
+    typedef entry_action<TTransition, TArgs...> TEntryActionWithArgs;
+    const auto signature_id = detail::signature<TArgs...>::id();
+    for (auto& binding : entry_actions_)
     {
-      if (auto ea = std::dynamic_pointer_cast<entry_action<TTransition, TArgs...>>(action))
+      if (binding.action->signature() == signature_id &&
+          (!binding.from_trigger || binding.trigger == transition.trigger()))
       {
-        ea->execute(transition, args...);
+        static_cast<const TEntryActionWithArgs&>(*binding.action).execute(transition, args...);
       }
     }
   }
@@ -277,16 +586,40 @@ private:
     }
   }
 
+  /// An entry action, optionally restricted to transitions caused by one trigger.
+  struct entry_action_binding
+  {
+    explicit entry_action_binding(TEntryAction entry_action)
+      : action(entry_action), from_trigger(false), trigger()
+    {}
+
+    entry_action_binding(TEntryAction entry_action, const TTrigger& entry_trigger)
+      : action(entry_action), from_trigger(true), trigger(entry_trigger)
+    {}
+
+    TEntryAction action;
+    bool from_trigger;
+    TTrigger trigger;
+  };
+
   const TState state_;
+  std::size_t id_;
+  arena* arena_;
 
-  std::map<TTrigger, std::vector<TTriggerBehaviour>> trigger_behaviours_;
-  std::vector<TEntryAction> entry_actions_;
+  TTriggerBehaviourMap trigger_behaviours_;
+  std::vector<entry_action_binding> entry_actions_;
   std::vector<TExitAction> exit_actions_;
 
   const state_representation* super_state_;
-  std::vector<const state_representation*> sub_states_;
+  std::vector<state_representation*> sub_states_;
+
+  /// The outermost superstate first and this state last.
+  std::vector<const state_representation*> ancestors_;
 };
 
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+const std::size_t state_representation<TState, TTrigger, TContainerPolicy>::npos;
+
 }
 
 }
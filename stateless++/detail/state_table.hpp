@@ -0,0 +1,424 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATELESS_DETAIL_STATE_TABLE_HPP
+#define STATELESS_DETAIL_STATE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../container_policy.hpp"
+#include "../trigger_with_parameters.hpp"
+#include "state_representation.hpp"
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * Flat transition table compiled from a set of state representations.
+ *
+ * States and triggers are assigned dense identifiers and the trigger
+ * behaviours of every state, followed by those inherited from its
+ * superstates, are laid out in a single contiguous states x triggers table.
+ * Behaviours whose destination is fixed at configuration time carry the
+ * representation of that destination, so firing them needs no lookup.
+ * Values are mapped to identifiers by the index containers of the
+ * container policy, and each state also keeps a short list of the
+ * triggers it handles so that they can be resolved without the index.
+ *
+ * Every state also has a bitset of the identifiers of the states it is
+ * equal to or a substate of, so testing for inclusion is a single bit test.
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class state_table
+{
+public:
+  typedef state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
+  typedef typename TStateRepresentation::TBehaviour TBehaviour;
+  typedef typename TStateRepresentation::TTriggerBehaviourList TTriggerBehaviourList;
+  typedef abstract_trigger_with_parameters<TTrigger> TAbstractTriggerWithParameters;
+
+  /// Identifier of a state or trigger that is not in the table.
+  static const std::size_t npos = TStateRepresentation::npos;
+
+  /// A candidate behaviour for a trigger in a state, as laid out in the table.
+  struct compiled_behaviour
+  {
+    /// The behaviour.
+    const TBehaviour* behaviour;
+
+    /**
+     * The destination of a behaviour whose decision is fixed at configuration
+     * time, or nullptr when the behaviour ignores the trigger.
+     */
+    const TStateRepresentation* destination;
+
+    /// Whether the decision was made when the table was compiled.
+    bool fixed;
+
+    /// Whether this is the last candidate configured on its state.
+    bool last_of_state;
+  };
+
+  state_table()
+    : state_ids_()
+    , trigger_ids_()
+    , triggers_()
+    , representations_()
+    , super_states_()
+    , ancestor_words_(0)
+    , ancestors_()
+    , cells_()
+    , behaviours_()
+    , handled_triggers_()
+    , handled_offsets_()
+    , parameters_()
+  {}
+
+  /**
+   * Compile the table.
+   *
+   * \param state_configuration Mapping from state to representation.
+   * \param trigger_configuration Mapping from trigger to parameter configuration.
+   */
+  template<typename TStateConfiguration, typename TTriggerConfiguration>
+  void compile(
+    const TStateConfiguration& state_configuration,
+    const TTriggerConfiguration& trigger_configuration)
+  {
+    state_ids_.clear();
+    trigger_ids_.clear();
+    triggers_.clear();
+    representations_.clear();
+    super_states_.clear();
+
+    for (const auto& entry : state_configuration)
+    {
+      entry.second->set_id(representations_.size());
+      state_ids_.insert(std::make_pair(entry.first, representations_.size()));
+      representations_.push_back(entry.second);
+      for (const auto& behaviours : entry.second->trigger_behaviours())
+      {
+        add_trigger(behaviours.first);
+      }
+    }
+    for (const auto& entry : trigger_configuration)
+    {
+      add_trigger(entry.first);
+    }
+
+    for (const auto representation : representations_)
+    {
+      const auto super_state = representation->super_state_representation();
+      super_states_.push_back(super_state == nullptr ? npos : super_state->id());
+    }
+
+    ancestor_words_ = (representations_.size() + word_bits - 1) / word_bits;
+    ancestors_.assign(representations_.size() * ancestor_words_, 0);
+    for (std::size_t s = 0; s < representations_.size(); ++s)
+    {
+      for (const auto ancestor : representations_[s]->ancestors())
+      {
+        const auto a = ancestor->id();
+        ancestors_[s * ancestor_words_ + a / word_bits] |= std::uint64_t(1) << (a % word_bits);
+      }
+    }
+
+    compile_cells();
+    compile_handled_triggers();
+
+    parameters_.assign(triggers_.size(), nullptr);
+    for (const auto& entry : trigger_configuration)
+    {
+      parameters_[trigger_id(entry.first)] = entry.second.get();
+    }
+  }
+
+  /// The identifier of the supplied state, or npos if it is not in the table.
+  std::size_t state_id(const TState& state) const
+  {
+    return find(state_ids_, state);
+  }
+
+  /// The identifier of the supplied trigger, or npos if it is not in the table.
+  std::size_t trigger_id(const TTrigger& trigger) const
+  {
+    return find(trigger_ids_, trigger);
+  }
+
+  /**
+   * The identifier of a trigger fired in a state. Triggers handled in the
+   * state are matched directly when there are few of them, and any other
+   * trigger falls back to the index.
+   */
+  std::size_t trigger_id(std::size_t state_id, const TTrigger& trigger) const
+  {
+    const auto first = handled_offsets_[state_id];
+    const auto last = handled_offsets_[state_id + 1];
+    if (last - first <= linear_search_limit)
+    {
+      for (auto i = first; i != last; ++i)
+      {
+        if (triggers_[handled_triggers_[i]] == trigger)
+        {
+          return handled_triggers_[i];
+        }
+      }
+    }
+    return trigger_id(trigger);
+  }
+
+  /// The number of triggers in the table.
+  std::size_t trigger_count() const
+  {
+    return triggers_.size();
+  }
+
+  /// The representation of the state with the supplied identifier.
+  const TStateRepresentation* representation(std::size_t state_id) const
+  {
+    return representations_[state_id];
+  }
+
+  /// The parameter configuration of a trigger, or nullptr if it has none.
+  const TAbstractTriggerWithParameters* trigger_parameters(std::size_t trigger_id) const
+  {
+    return trigger_id == npos ? nullptr : parameters_[trigger_id];
+  }
+
+  /**
+   * Find the behaviour that handles a trigger in a state, searching
+   * superstates when the state itself has no permitted behaviour.
+   *
+   * \param state_id The state identifier.
+   * \param trigger_id The trigger identifier.
+   * \param conflict Set when more than one candidate has its guard condition met,
+   *                 in which case no behaviour is returned.
+   */
+  const compiled_behaviour* try_find_handler(
+    std::size_t state_id, std::size_t trigger_id, bool& conflict) const
+  {
+    if (trigger_id == npos)
+    {
+      return nullptr;
+    }
+    const auto& cell = cells_[state_id * triggers_.size() + trigger_id];
+    const compiled_behaviour* result = nullptr;
+    for (auto i = cell.first; i != cell.second; ++i)
+    {
+      const auto& candidate = behaviours_[i];
+      if (candidate.behaviour->is_condition_met())
+      {
+        if (result != nullptr)
+        {
+          conflict = true;
+          return nullptr;
+        }
+        result = &candidate;
+      }
+      if (candidate.last_of_state && result != nullptr)
+      {
+        return result;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Fill a bitset, indexed by trigger identifier, with the triggers permitted
+   * in a state or inherited from its superstates.
+   */
+  void permitted_trigger_mask(std::size_t state_id, std::vector<bool>& mask) const
+  {
+    mask.assign(triggers_.size(), false);
+    for (std::size_t t = 0; t < triggers_.size(); ++t)
+    {
+      const auto& cell = cells_[state_id * triggers_.size() + t];
+      for (auto i = cell.first; i != cell.second; ++i)
+      {
+        if (behaviours_[i].behaviour->is_condition_met())
+        {
+          mask[t] = true;
+          break;
+        }
+      }
+    }
+  }
+
+  /// Determine whether a state is equal to, or a substate of, another.
+  bool is_included_in(std::size_t state_id, std::size_t super_state_id) const
+  {
+    if (super_state_id == npos)
+    {
+      return false;
+    }
+    const auto word = ancestors_[state_id * ancestor_words_ + super_state_id / word_bits];
+    return ((word >> (super_state_id % word_bits)) & 1) != 0;
+  }
+
+private:
+  typedef typename TContainerPolicy::template index<TState, std::size_t>::type TStateIndex;
+  typedef typename TContainerPolicy::template index<TTrigger, std::size_t>::type TTriggerIndex;
+
+  static const std::size_t word_bits = 64;
+
+  /// Largest number of handled triggers that are searched one by one.
+  static const std::size_t linear_search_limit = 8;
+
+  /**
+   * Lay out the candidates of every state and trigger, followed by those of
+   * the superstates, deciding fixed destinations as they are added.
+   */
+  void compile_cells()
+  {
+    cells_.assign(representations_.size() * triggers_.size(), std::make_pair(0, 0));
+    behaviours_.clear();
+    for (std::size_t s = 0; s < representations_.size(); ++s)
+    {
+      for (std::size_t t = 0; t < triggers_.size(); ++t)
+      {
+        auto& cell = cells_[s * triggers_.size() + t];
+        cell.first = behaviours_.size();
+        for (auto level = s; level != npos; level = super_states_[level])
+        {
+          const auto& behaviours = representations_[level]->trigger_behaviours();
+          const auto candidates = behaviours.find(triggers_[t]);
+          if (candidates == behaviours.end() || candidates->second.empty())
+          {
+            continue;
+          }
+          for (const auto candidate : candidates->second)
+          {
+            behaviours_.push_back(compile_behaviour(s, candidate));
+          }
+          behaviours_.back().last_of_state = true;
+        }
+        cell.second = behaviours_.size();
+      }
+    }
+  }
+
+  /**
+   * Compile a candidate fired from a state. The decision of a behaviour
+   * without arguments depends only on the source state, so it is made once.
+   */
+  compiled_behaviour compile_behaviour(std::size_t source_id, const TBehaviour* behaviour) const
+  {
+    compiled_behaviour result = { behaviour, nullptr, false, false };
+    if (behaviour->signature() == nullptr)
+    {
+      TState destination;
+      if (!behaviour->results_in_transition_from(
+            representations_[source_id]->underlying_state(), destination))
+      {
+        result.fixed = true;
+      }
+      else
+      {
+        const auto id = state_id(destination);
+        if (id != npos)
+        {
+          result.destination = representations_[id];
+          result.fixed = true;
+        }
+      }
+    }
+    return result;
+  }
+
+  /// List, for every state, the triggers that have candidates in it.
+  void compile_handled_triggers()
+  {
+    handled_triggers_.clear();
+    handled_offsets_.assign(1, 0);
+    for (std::size_t s = 0; s < representations_.size(); ++s)
+    {
+      for (std::size_t t = 0; t < triggers_.size(); ++t)
+      {
+        const auto& cell = cells_[s * triggers_.size() + t];
+        if (cell.first != cell.second)
+        {
+          handled_triggers_.push_back(t);
+        }
+      }
+      handled_offsets_.push_back(handled_triggers_.size());
+    }
+  }
+
+  void add_trigger(const TTrigger& trigger)
+  {
+    if (trigger_ids_.insert(std::make_pair(trigger, triggers_.size())).second)
+    {
+      triggers_.push_back(trigger);
+    }
+  }
+
+  template<typename TIndex, typename TValue>
+  static std::size_t find(const TIndex& index, const TValue& value)
+  {
+    auto it = index.find(value);
+    return it == index.end() ? npos : it->second;
+  }
+
+  TStateIndex state_ids_;
+  TTriggerIndex trigger_ids_;
+  std::vector<TTrigger> triggers_;
+  std::vector<const TStateRepresentation*> representations_;
+  std::vector<std::size_t> super_states_;
+
+  /// Number of words in the ancestor bitset of each state.
+  std::size_t ancestor_words_;
+
+  /// The ancestor bitsets of all states, ancestor_words_ words per state.
+  std::vector<std::uint64_t> ancestors_;
+
+  /// Range of behaviours_ holding the candidates of each state and trigger.
+  std::vector<std::pair<std::size_t, std::size_t>> cells_;
+
+  /// The candidates of all cells, those of a state before its superstates.
+  std::vector<compiled_behaviour> behaviours_;
+
+  /// Identifiers of the triggers handled in each state, grouped by state.
+  std::vector<std::size_t> handled_triggers_;
+
+  /// Start of the handled triggers of each state, plus a final end offset.
+  std::vector<std::size_t> handled_offsets_;
+
+  std::vector<const TAbstractTriggerWithParameters*> parameters_;
+};
+
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+const std::size_t state_table<TState, TTrigger, TContainerPolicy>::npos;
+
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+const std::size_t state_table<TState, TTrigger, TContainerPolicy>::word_bits;
+
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+const std::size_t state_table<TState, TTrigger, TContainerPolicy>::linear_search_limit;
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_STATE_TABLE_HPP
@@ -17,6 +17,8 @@
 #ifndef STATELESS_DETAIL_TRANSITION_HPP
 #define STATELESS_DETAIL_TRANSITION_HPP
 
+#include <cstddef>
+
 namespace stateless
 {
 
@@ -27,11 +29,19 @@ template<typename TState, typename TTrigger>
 class transition
 {
 public:
+  /**
+   * \param source The state left.
+   * \param destination The state entered.
+   * \param trigger The trigger fired.
+   * \param instance_id Identifies the instance of a machine_definition that
+   *                    transitioned; 0 for a state_machine.
+   */
   transition(
     const TState& source,
     const TState& destination,
-    const TTrigger& trigger)
-    : source_(source), destination_(destination), trigger_(trigger)
+    const TTrigger& trigger,
+    std::size_t instance_id = 0)
+    : source_(source), destination_(destination), trigger_(trigger), instance_id_(instance_id)
   {}
 
   const TState& source() const { return source_; }
@@ -40,12 +50,15 @@ public:
 
   const TTrigger& trigger() const { return trigger_; }
 
+  std::size_t instance_id() const { return instance_id_; }
+
   bool is_reentry() const { return source_ == destination_; }
       
 private:
   const TState source_;
   const TState destination_;
   const TTrigger trigger_;
+  const std::size_t instance_id_;
 };
 
 }
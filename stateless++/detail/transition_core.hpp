@@ -0,0 +1,190 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATELESS_DETAIL_TRANSITION_CORE_HPP
+#define STATELESS_DETAIL_TRANSITION_CORE_HPP
+
+#include <cstddef>
+
+#include "../fire_result.hpp"
+#include "signature.hpp"
+#include "state_representation.hpp"
+#include "trigger_behaviour.hpp"
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/**
+ * The behaviour chosen to handle a trigger, together with its destination
+ * when that was decided when the machine was frozen.
+ */
+template<typename TStateRepresentation>
+struct selected_behaviour
+{
+  /// The behaviour, or nullptr if the trigger is not handled.
+  const typename TStateRepresentation::TBehaviour* behaviour;
+
+  /// The fixed destination, or nullptr when fixed and the trigger is ignored.
+  const TStateRepresentation* destination;
+
+  /// Whether destination holds the decision of the behaviour.
+  bool fixed;
+};
+
+/**
+ * Carry out a transition whose destination has been resolved: exit the
+ * source, move the cursor and enter the destination, telling the cursor
+ * before and after the entry actions. See try_fire() for the cursor.
+ *
+ * \param cursor The cursor.
+ * \param representation The source state.
+ * \param destination_representation The destination state.
+ * \param transition The transition.
+ * \param args The arguments to pass to the entry actions.
+ */
+template<
+  typename TCursor,
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy,
+  typename... TArgs>
+void transition_to(
+  TCursor& cursor,
+  const state_representation<TState, TTrigger, TContainerPolicy>* representation,
+  const state_representation<TState, TTrigger, TContainerPolicy>* destination_representation,
+  const typename state_representation<TState, TTrigger, TContainerPolicy>::TTransition& transition,
+  const TArgs&... args)
+{
+  representation->exit_to(transition, destination_representation);
+  cursor.set_current(destination_representation);
+  cursor.transitioned(transition);
+  destination_representation->enter_from(transition, representation, args...);
+  cursor.entered(transition);
+}
+
+/**
+ * Fire a trigger from a resolved current state. This is the transition logic
+ * shared by every machine; the machines differ only in how they look up
+ * behaviours and where they keep the current state.
+ *
+ * The table resolves triggers and states:
+ * - std::size_t trigger_key(representation, trigger) identifies the trigger,
+ *   once, for the two lookups that follow;
+ * - trigger_parameters(trigger, key) is the parameter configuration or nullptr;
+ * - find_handler(representation, trigger, key, conflict) is the selected_behaviour;
+ * - find_representation(state) is the representation of a destination.
+ *
+ * The cursor holds the current state of one instance:
+ * - instance_id() identifies the instance in the transition;
+ * - set_current(representation) moves it, between exit and entry actions;
+ * - transitioned(transition) is called before the entry actions;
+ * - entered(transition) is called after them.
+ *
+ * \param table The table.
+ * \param cursor The cursor.
+ * \param representation The current state.
+ * \param trigger The trigger to fire.
+ * \param args The arguments to pass in the transition.
+ *
+ * \return The outcome; nothing is changed unless it is transitioned.
+ */
+template<
+  typename TTable,
+  typename TCursor,
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy,
+  typename... TArgs>
+fire_result try_fire(
+  const TTable& table,
+  TCursor& cursor,
+  const state_representation<TState, TTrigger, TContainerPolicy>* representation,
+  const TTrigger& trigger,
+  const TArgs&... args)
+{
+  typedef state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
+  typedef typename TStateRepresentation::TTransition TTransition;
+  typedef dynamic_trigger_behaviour<TState, TTrigger, TArgs...> TDynamicTriggerBehaviour;
+
+  const auto signature_id = signature<TArgs...>::id();
+  const std::size_t key = table.trigger_key(representation, trigger);
+  const auto configuration = table.trigger_parameters(trigger, key);
+  if (configuration != nullptr && configuration->signature() != signature_id)
+  {
+    return fire_result::bad_parameters;
+  }
+
+  bool conflict = false;
+  const auto selected = table.find_handler(representation, trigger, key, conflict);
+  if (conflict)
+  {
+    return fire_result::guard_conflict;
+  }
+  const auto handler = selected.behaviour;
+  if (handler == nullptr)
+  {
+    return fire_result::unhandled;
+  }
+
+  const auto& source = representation->underlying_state();
+  TState destination;
+  const TStateRepresentation* destination_representation = nullptr;
+  bool is_transition = false;
+
+  if (handler->signature() == signature_id)
+  {
+    // A dynamic behaviour is configured, so forward the arguments to it.
+    is_transition = static_cast<const TDynamicTriggerBehaviour*>(handler)
+      ->results_in_transition_from(source, destination, args...);
+  }
+  else if (selected.fixed)
+  {
+    // The configuration time defined transition was decided by freeze().
+    destination_representation = selected.destination;
+    is_transition = destination_representation != nullptr;
+    if (is_transition)
+    {
+      destination = destination_representation->underlying_state();
+    }
+  }
+  else
+  {
+    // Fall back to configuration time defined transition.
+    is_transition = handler->results_in_transition_from(source, destination);
+  }
+
+  if (!is_transition)
+  {
+    return fire_result::ignored;
+  }
+
+  TTransition transition(source, destination, trigger, cursor.instance_id());
+  if (destination_representation == nullptr)
+  {
+    destination_representation = table.find_representation(transition.destination());
+  }
+  transition_to(cursor, representation, destination_representation, transition, args...);
+  return fire_result::transitioned;
+}
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_TRANSITION_CORE_HPP
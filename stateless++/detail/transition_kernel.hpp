@@ -0,0 +1,289 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_DETAIL_TRANSITION_KERNEL_HPP
+#define STATELESS_DETAIL_TRANSITION_KERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized kernels are compiled for x86 with GCC and Clang, which can
+// target instruction sets per function and detect them at run time.
+// Define STATELESS_NO_SIMD to use the scalar kernel only.
+#if !defined(STATELESS_NO_SIMD) && \
+    (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define STATELESS_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace stateless
+{
+
+namespace detail
+{
+
+/// Instruction sets the transition kernel can use.
+enum class simd_level
+{
+  scalar,
+  sse42,
+  avx2
+};
+
+/// The best instruction set supported by the processor, detected once.
+inline simd_level detected_simd_level()
+{
+#ifdef STATELESS_SIMD_X86
+  static const simd_level level =
+    __builtin_cpu_supports("avx2") ? simd_level::avx2
+    : __builtin_cpu_supports("sse4.2") ? simd_level::sse42
+    : simd_level::scalar;
+  return level;
+#else
+  return simd_level::scalar;
+#endif
+}
+
+/// Scalar implementation of select_changed() for the states from first to last.
+template<typename TStateStorage>
+std::size_t select_changed_scalar(
+  const TStateStorage* states,
+  std::size_t first,
+  std::size_t last,
+  const std::uint32_t* next,
+  std::uint32_t* changed,
+  std::size_t n)
+{
+  for (auto i = first; i < last; ++i)
+  {
+    if (next[states[i]] != states[i])
+    {
+      changed[n++] = static_cast<std::uint32_t>(i);
+    }
+  }
+  return n;
+}
+
+#ifdef STATELESS_SIMD_X86
+
+/// Append base plus the position of each set bit of mask to changed.
+inline std::size_t emit_changed(
+  std::uint32_t mask, std::size_t base, std::uint32_t* changed, std::size_t n)
+{
+  while (mask != 0)
+  {
+    changed[n++] = static_cast<std::uint32_t>(base + __builtin_ctz(mask));
+    mask &= mask - 1;
+  }
+  return n;
+}
+
+/// Load eight states widened to 32 bit lanes.
+__attribute__((target("avx2")))
+inline __m256i load_states_avx2(const std::uint8_t* states)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(states)));
+}
+
+/// Load eight states widened to 32 bit lanes.
+__attribute__((target("avx2")))
+inline __m256i load_states_avx2(const std::uint16_t* states)
+{
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(states)));
+}
+
+/// AVX2 implementation of select_changed(), gathering eight next states at a time.
+template<typename TStateStorage>
+__attribute__((target("avx2")))
+std::size_t select_changed_avx2(
+  const TStateStorage* states,
+  std::size_t count,
+  const std::uint32_t* next,
+  std::uint32_t* changed)
+{
+  const auto table = reinterpret_cast<const int*>(next);
+  std::size_t n = 0;
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    const auto current = load_states_avx2(states + i);
+    const auto following = _mm256_i32gather_epi32(table, current, 4);
+    const auto same = _mm256_movemask_ps(
+      _mm256_castsi256_ps(_mm256_cmpeq_epi32(current, following)));
+    n = emit_changed(~static_cast<std::uint32_t>(same) & 0xFF, i, changed, n);
+  }
+  return select_changed_scalar(states, i, count, next, changed, n);
+}
+
+/**
+ * The table of at most sixteen next states narrowed to bytes. States never
+ * reach 0xFF, so it marks the states that always need the full fire.
+ */
+inline void narrow_table(
+  const std::uint32_t* next, std::size_t state_count, std::uint8_t* bytes)
+{
+  for (std::size_t s = 0; s < 16; ++s)
+  {
+    bytes[s] = s >= state_count ? 0
+      : next[s] > 0xFF ? 0xFF
+      : static_cast<std::uint8_t>(next[s]);
+  }
+}
+
+/// Load sixteen states narrowed to bytes.
+__attribute__((target("sse4.2")))
+inline __m128i load_states_sse42(const std::uint8_t* states)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(states));
+}
+
+/// Load sixteen states narrowed to bytes.
+__attribute__((target("sse4.2")))
+inline __m128i load_states_sse42(const std::uint16_t* states)
+{
+  return _mm_packus_epi16(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(states)),
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(states + 8)));
+}
+
+/**
+ * SSE4.2 implementation of select_changed() for at most sixteen states.
+ * The table fits in one register, so sixteen next states are looked up
+ * with a single byte shuffle.
+ */
+template<typename TStateStorage>
+__attribute__((target("sse4.2")))
+std::size_t select_changed_sse42(
+  const TStateStorage* states,
+  std::size_t count,
+  const std::uint32_t* next,
+  std::size_t state_count,
+  std::uint32_t* changed)
+{
+  alignas(16) std::uint8_t bytes[16];
+  narrow_table(next, state_count, bytes);
+  const auto table = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+
+  std::size_t n = 0;
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    const auto current = load_states_sse42(states + i);
+    const auto following = _mm_shuffle_epi8(table, current);
+    const auto same = _mm_movemask_epi8(_mm_cmpeq_epi8(current, following));
+    n = emit_changed(~static_cast<std::uint32_t>(same) & 0xFFFF, i, changed, n);
+  }
+  return select_changed_scalar(states, i, count, next, changed, n);
+}
+
+/// Load thirty-two states narrowed to bytes.
+__attribute__((target("avx2")))
+inline __m256i load_narrow_states_avx2(const std::uint8_t* states)
+{
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states));
+}
+
+/// Load thirty-two states narrowed to bytes.
+__attribute__((target("avx2")))
+inline __m256i load_narrow_states_avx2(const std::uint16_t* states)
+{
+  // Packing works within each 128 bit lane, so restore the order of the quarters.
+  return _mm256_permute4x64_epi64(
+    _mm256_packus_epi16(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + 16))),
+    0xD8);
+}
+
+/**
+ * AVX2 implementation of select_changed() for at most sixteen states,
+ * looking up thirty-two next states with a single byte shuffle.
+ */
+template<typename TStateStorage>
+__attribute__((target("avx2")))
+std::size_t select_changed_shuffle_avx2(
+  const TStateStorage* states,
+  std::size_t count,
+  const std::uint32_t* next,
+  std::size_t state_count,
+  std::uint32_t* changed)
+{
+  alignas(16) std::uint8_t bytes[16];
+  narrow_table(next, state_count, bytes);
+  const auto table = _mm256_broadcastsi128_si256(
+    _mm_load_si128(reinterpret_cast<const __m128i*>(bytes)));
+
+  std::size_t n = 0;
+  std::size_t i = 0;
+  for (; i + 32 <= count; i += 32)
+  {
+    const auto current = load_narrow_states_avx2(states + i);
+    const auto following = _mm256_shuffle_epi8(table, current);
+    const auto same = _mm256_movemask_epi8(_mm256_cmpeq_epi8(current, following));
+    n = emit_changed(~static_cast<std::uint32_t>(same), i, changed, n);
+  }
+  return select_changed_scalar(states, i, count, next, changed, n);
+}
+
+#endif // STATELESS_SIMD_X86
+
+/**
+ * Find the instances whose state a trigger changes, given the states of the
+ * instances as small integers and the next state of each state.
+ *
+ * \param level The instruction set to use; falls back to a narrower one
+ *              where the wider cannot handle the table.
+ * \param states The state of each instance.
+ * \param count The number of instances.
+ * \param next The next state of each state, or a value that is not a state.
+ * \param state_count The number of entries in next.
+ * \param changed Output receiving, in increasing order, the index of each
+ *                instance whose next state differs from its state. Must have
+ *                room for count indices.
+ *
+ * \return The number of indices written.
+ */
+template<typename TStateStorage>
+std::size_t select_changed(
+  simd_level level,
+  const TStateStorage* states,
+  std::size_t count,
+  const std::uint32_t* next,
+  std::size_t state_count,
+  std::uint32_t* changed)
+{
+#ifdef STATELESS_SIMD_X86
+  if (level == simd_level::avx2)
+  {
+    return state_count <= 16
+      ? select_changed_shuffle_avx2(states, count, next, state_count, changed)
+      : select_changed_avx2(states, count, next, changed);
+  }
+  if (level == simd_level::sse42 && state_count <= 16)
+  {
+    return select_changed_sse42(states, count, next, state_count, changed);
+  }
+#endif
+  return select_changed_scalar(states, 0, count, next, changed, 0);
+}
+
+}
+
+}
+
+#endif // STATELESS_DETAIL_TRANSITION_KERNEL_HPP
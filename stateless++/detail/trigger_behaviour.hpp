@@ -17,9 +17,9 @@
 #ifndef STATELESS_DETAIL_TRIGGER_BEHAVIOUR_HPP
 #define STATELESS_DETAIL_TRIGGER_BEHAVIOUR_HPP
 
-#include <functional>
-
 #include "../error.hpp"
+#include "../inplace_function.hpp"
+#include "signature.hpp"
 
 namespace stateless
 {
@@ -30,21 +30,45 @@ namespace detail
 class abstract_trigger_behaviour
 {
 public:
-  typedef std::function<bool()> TGuard;
-
-  abstract_trigger_behaviour(const TGuard& guard)
+  typedef inplace_function<bool()> TGuard;
+
+  /**
+   * \param guard Function that must return true in order for the trigger to be
+   *              accepted, or an empty function if the behaviour is unguarded.
+   * \param signature Identifies the argument types of a dynamic behaviour.
+   */
+  abstract_trigger_behaviour(const TGuard& guard, signature_id signature = nullptr)
     : guard_(guard)
+    , guarded_(static_cast<bool>(guard))
+    , signature_(signature)
   {}
 
+  /// Determine whether the behaviour has a guard that must be evaluated.
+  bool is_guarded() const
+  {
+    return guarded_;
+  }
+
   bool is_condition_met() const
   {
-    return guard_();
+    return !guarded_ || guard_();
+  }
+
+  /**
+   * Identifies the argument types accepted by a dynamic behaviour.
+   * Null for behaviours whose destination is defined at configuration time.
+   */
+  signature_id signature() const
+  {
+    return signature_;
   }
 
   virtual ~abstract_trigger_behaviour() = 0;
 
 private:
   TGuard guard_;
+  const bool guarded_;
+  const signature_id signature_;
 };
 
 inline abstract_trigger_behaviour::~abstract_trigger_behaviour()
@@ -55,7 +79,10 @@ class trigger_behaviour
   : public abstract_trigger_behaviour
 {
 public:
-  typedef std::function<bool(const TState&, TState&)> TDecision;
+  /// Decision signature, with room for a captured destination state.
+  typedef inplace_function<
+    bool(const TState&, TState&),
+    STATELESS_INPLACE_FUNCTION_CAPACITY + sizeof(TState)> TDecision;
 
   trigger_behaviour(
     const TTrigger& trigger,
@@ -75,16 +102,18 @@ public:
   {
     if (!decision_)
     {
-      throw error("Static trigger behaviour decision is not set. "
+      raise_error("Static trigger behaviour decision is not set. "
         "The state machine is misconfigured.");
     }
     return decision_(source, destination);
   }
 
+protected:
   trigger_behaviour(
     const TTrigger& trigger,
-    const abstract_trigger_behaviour::TGuard& guard)
-    : abstract_trigger_behaviour(guard)
+    const abstract_trigger_behaviour::TGuard& guard,
+    signature_id signature)
+    : abstract_trigger_behaviour(guard, signature)
     , trigger_(trigger)
   {}
 
@@ -98,17 +127,18 @@ class dynamic_trigger_behaviour
   : public trigger_behaviour<TState, TTrigger>
 {
 public:
-  typedef typename std::function<TState(TArgs...)> TDecision;
+  typedef inplace_function<TState(const TArgs&...)> TDecision;
 
   dynamic_trigger_behaviour(
     const TTrigger& trigger,
     const abstract_trigger_behaviour::TGuard& guard,
     const TDecision& decision)
-    : trigger_behaviour<TState, TTrigger>(trigger, guard)
+    : trigger_behaviour<TState, TTrigger>(trigger, guard, detail::signature<TArgs...>::id())
     , decision_(decision)
   {}
 
-  bool results_in_transition_from(const TState& source, TState& destination, TArgs... args) const
+  bool results_in_transition_from(
+    const TState& source, TState& destination, const TArgs&... args) const
   {
     destination = decision_(args...);
     return true;
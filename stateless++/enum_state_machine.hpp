@@ -0,0 +1,495 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_ENUM_STATE_MACHINE_HPP
+#define STATELESS_ENUM_STATE_MACHINE_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+
+#include "detail/enum_configuration.hpp"
+#include "detail/firing.hpp"
+#include "detail/mpsc_queue.hpp"
+#include "detail/transition_core.hpp"
+#include "fire_result.hpp"
+#include "inplace_function.hpp"
+#include "print_state.hpp"
+#include "print_trigger.hpp"
+#include "state_configuration.hpp"
+#include "trigger_with_parameters.hpp"
+
+namespace stateless
+{
+
+/**
+ * Models behaviour as transitions between a finite set of enumerated states.
+ *
+ * Offers the same configuration interface as state_machine, but state
+ * representations are indexed by the enumerator value and triggers are
+ * dispatched through a dense states x triggers table, so firing a trigger
+ * performs no searching.
+ *
+ * \tparam TState The enumeration used to represent the states. Its enumerators
+ *                must be the consecutive values 0 to NStates - 1.
+ * \tparam TTrigger The enumeration used to represent the triggers. Its enumerators
+ *                  must be the consecutive values 0 to NTriggers - 1.
+ * \tparam NStates The number of states.
+ * \tparam NTriggers The number of triggers.
+ */
+template<typename TState, typename TTrigger, std::size_t NStates, std::size_t NTriggers>
+class enum_state_machine
+{
+  static_assert(std::is_enum<TState>::value, "The state type must be an enumeration.");
+  static_assert(std::is_enum<TTrigger>::value, "The trigger type must be an enumeration.");
+
+public:
+  /// Parameterized state configuration type.
+  typedef state_configuration<TState, TTrigger> TStateConfiguration;
+
+  /// Parameterized transition type.
+  typedef typename TStateConfiguration::TTransition TTransition;
+
+  /// Parameterized trigger with parameters type.
+  typedef typename TStateConfiguration::TTriggerWithParameters TTriggerWithParameters;
+
+  /// Signature for handler for unhandled trigger. By default this throws an error.
+  typedef inplace_function<void(const TState&, const TTrigger&)> TUnhandledTriggerAction;
+
+  /// Signature for handler for state transition. Does nothing by default.
+  typedef inplace_function<void(const TTransition&)> TTransitionAction;
+
+  /**
+   * Construct a state machine.
+   *
+   * \param initial_state The initial state.
+   */
+  enum_state_machine(const TState& initial_state)
+    : configuration_()
+    , deferred_triggers_(STATELESS_DEFERRED_TRIGGER_CAPACITY)
+    , current_(nullptr)
+    , on_unhandled_trigger_()
+    , on_transition_()
+  {
+    current_ = configuration_.get_representation(initial_state);
+    on_unhandled_trigger_ = &detail::raise_unhandled_trigger<TState, TTrigger>;
+  }
+
+  /// The current state.
+  const TState state() const
+  {
+    return current_->underlying_state();
+  }
+
+  /**
+   * Begin configuration of the entry/exit actions and allowed transitions
+   * when the state machine is in a particular state.
+   *
+   * \param state The state to configure.
+   *
+   * \return A configuration object through which the state can be configured.
+   */
+  TStateConfiguration configure(const TState& state)
+  {
+    return configuration_.configure(state);
+  }
+
+  /**
+   * Transition from the current state via the supplied trigger.
+   *
+   * \param trigger The trigger to fire.
+   *
+   * \throw error The current state does not allow the trigger to be fired.
+   */
+  void fire(const TTrigger& trigger)
+  {
+    internal_fire(trigger);
+  }
+
+  /**
+   * Transition from the current state via the supplied trigger.
+   *
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \throw error The current state does not allow the trigger to be fired.
+   */
+  template<typename... TArgs, typename... TParams>
+  void fire(
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args)
+  {
+    internal_fire<TArgs...>(trigger->trigger(), std::forward<TParams>(args)...);
+  }
+
+  /**
+   * Transition from the current state via the supplied trigger, reporting
+   * failures in the returned value rather than by throwing. The unhandled
+   * trigger action is not called.
+   *
+   * \param trigger The trigger to fire.
+   *
+   * \return The outcome of firing the trigger.
+   */
+  fire_result try_fire(const TTrigger& trigger)
+  {
+    return internal_try_fire(trigger);
+  }
+
+  /**
+   * Transition from the current state via the supplied trigger, reporting
+   * failures in the returned value rather than by throwing.
+   *
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \return The outcome of firing the trigger.
+   */
+  template<typename... TArgs, typename... TParams>
+  fire_result try_fire(
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args)
+  {
+    return internal_try_fire<TArgs...>(trigger->trigger(), std::forward<TParams>(args)...);
+  }
+
+  /**
+   * Fire a sequence of triggers in order, each running to completion before
+   * the next.
+   *
+   * Triggers that are not handled are reported in the result as by
+   * try_fire(); the unhandled trigger action is not called.
+   *
+   * \param first The first trigger to fire.
+   * \param last One past the last trigger to fire.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   */
+  template<typename TInputIterator>
+  batch_result fire_all(
+    TInputIterator first,
+    TInputIterator last,
+    batch_policy policy = batch_policy::stop_on_failure)
+  {
+    return detail::fire_sequence(first, last, policy, [this](const TTrigger& trigger)
+      {
+        return internal_try_fire(trigger);
+      });
+  }
+
+  /**
+   * Fire a contiguous range of triggers in order, such as an array or vector.
+   *
+   * \param triggers The triggers to fire.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   */
+  template<typename TRange>
+  batch_result fire_all(
+    const TRange& triggers,
+    batch_policy policy = batch_policy::stop_on_failure)
+  {
+    return fire_all(std::begin(triggers), std::end(triggers), policy);
+  }
+
+  /**
+   * Queue a trigger to be fired later by the thread that owns the state
+   * machine. May be called from any thread; it never blocks, and only the
+   * first trigger queued allocates the queue.
+   *
+   * \param trigger The trigger to queue.
+   *
+   * \return False if the queue of deferred triggers is full, in which case
+   *         the trigger is dropped. The capacity is set by
+   *         STATELESS_DEFERRED_TRIGGER_CAPACITY.
+   */
+  bool push_deferred_trigger(const TTrigger& trigger)
+  {
+    return deferred_triggers_.push(trigger);
+  }
+
+  /**
+   * Fire the oldest deferred trigger, removing it from the queue once it
+   * has been fired. Must only be called by the thread that owns the state
+   * machine.
+   *
+   * \return False if no trigger was deferred.
+   */
+  bool pop_deferred_trigger()
+  {
+    return drain_deferred_triggers(1) == 1;
+  }
+
+  /**
+   * Fire deferred triggers in the order they were queued until none is left.
+   * Must only be called by the thread that owns the state machine.
+   *
+   * \param max_triggers The maximum number of triggers to fire.
+   *
+   * \return The number of triggers fired.
+   */
+  std::size_t drain_deferred_triggers(
+    std::size_t max_triggers = static_cast<std::size_t>(-1))
+  {
+    return detail::drain_queue(deferred_triggers_, max_triggers, [this](const TTrigger& trigger)
+      {
+        internal_fire(trigger);
+      });
+  }
+
+  /**
+   * Register a callback that will be invoked every time the state machine
+   * transitions from one state into another.
+   *
+   * \param action The action to execute, accepting the details of the transition.
+   */
+  void on_transition(const TTransitionAction& action)
+  {
+    on_transition_ = action;
+  }
+
+  /**
+   * Override the default behaviour of throwing an exception when an
+   * unhandled trigger is fired.
+   *
+   * \param action An action to call when an unhandled trigger is fired.
+   */
+  void on_unhandled_trigger(const TUnhandledTriggerAction& action)
+  {
+    on_unhandled_trigger_ = action;
+  }
+
+  /**
+   * Determine whether the state machine is in the supplied state.
+   *
+   * \param state The state to test for.
+   *
+   * \return True if the current state is equal to, or a substate of, the supplied state.
+   */
+  bool is_in_state(const TState& state) const
+  {
+    return current_->is_included_in(state);
+  }
+
+  /**
+   * Determine whether supplied trigger can be fired in the current state.
+   *
+   * \param trigger Trigger to test.
+   *
+   * \return True if the trigger can be fired, false otherwise.
+   */
+  bool can_fire(const TTrigger& trigger) const
+  {
+    return configuration_.find_handler(current_, trigger) != nullptr;
+  }
+
+  /**
+   * Determine for each of a sequence of triggers whether it can be fired
+   * in the current state.
+   *
+   * \param first The first trigger to test.
+   * \param last One past the last trigger to test.
+   * \param result Output receiving one bool per trigger.
+   *
+   * \return Output iterator one past the last result written.
+   */
+  template<typename TInputIterator, typename TOutputIterator>
+  TOutputIterator can_fire_many(
+    TInputIterator first, TInputIterator last, TOutputIterator result) const
+  {
+    for (; first != last; ++first, ++result)
+    {
+      *result = configuration_.find_handler(current_, *first) != nullptr;
+    }
+    return result;
+  }
+
+  /**
+   * Specify the arguments that must be supplied when a specific trigger is fired.
+   *
+   * \param trigger The underlying trigger value.
+   *
+   * \return An object that can be passed to the fire() method in order to
+   *         fire the parameterised trigger.
+   */
+  template<typename... TArgs>
+  std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>
+  set_trigger_parameters(const TTrigger& trigger)
+  {
+    return configuration_.template set_trigger_parameters<TArgs...>(trigger);
+  }
+
+  /**
+   * The currently permissible trigger values.
+   */
+  std::set<TTrigger> permitted_triggers() const
+  {
+    std::set<TTrigger> result;
+    for_each_permitted_trigger([&](const TTrigger& trigger) { result.insert(trigger); });
+    return result;
+  }
+
+  /**
+   * Invoke a visitor with each currently permissible trigger value, in
+   * enumerator order and without allocating.
+   *
+   * \param visitor Callable accepting a const TTrigger&.
+   */
+  template<typename TVisitor>
+  void for_each_permitted_trigger(TVisitor visitor) const
+  {
+    std::bitset<NTriggers> mask;
+    permitted_trigger_mask(mask);
+    for (std::size_t t = 0; t < NTriggers; ++t)
+    {
+      if (mask[t])
+      {
+        visitor(static_cast<TTrigger>(t));
+      }
+    }
+  }
+
+  /**
+   * Fill a bitset, indexed by trigger enumerator value, with the currently
+   * permissible triggers.
+   *
+   * \param mask The bitset to fill.
+   */
+  void permitted_trigger_mask(std::bitset<NTriggers>& mask) const
+  {
+    configuration_.permitted_trigger_mask(current_, mask);
+  }
+
+  /**
+   * A human readable representation of the state machine.
+   *
+   * \return A description of the current state and permitted triggers.
+   */
+  std::string print() const
+  {
+    std::ostringstream oss;
+    print(oss);
+    return oss.str();
+  }
+
+  /**
+   * Stream output operator.
+   */
+  friend inline std::ostream& operator<<(std::ostream& os, const enum_state_machine& sm)
+  {
+    sm.print(os);
+    return os;
+  }
+
+private:
+  enum_state_machine(const enum_state_machine&);
+  enum_state_machine& operator=(const enum_state_machine&);
+
+  /// Parameterized configuration type.
+  typedef detail::enum_configuration<TState, TTrigger, NStates, NTriggers> TConfiguration;
+
+  /// Parameterized state representation type.
+  typedef typename TConfiguration::TStateRepresentation TStateRepresentation;
+
+  /// Where try_fire() keeps the current state: the machine itself.
+  struct cursor
+  {
+    std::size_t instance_id() const
+    {
+      return 0;
+    }
+
+    void set_current(const TStateRepresentation* representation)
+    {
+      machine->current_ = representation;
+    }
+
+    void transitioned(const TTransition& transition)
+    {
+      if (machine->on_transition_)
+      {
+        machine->on_transition_(transition);
+      }
+    }
+
+    void entered(const TTransition& transition)
+    {
+    }
+
+    enum_state_machine* machine;
+  };
+
+  /// Implementation of state transition given a trigger, reporting errors by throwing.
+  template<typename... TArgs>
+  void internal_fire(const TTrigger& trigger, const TArgs&... args)
+  {
+    const auto representation = current_;
+    detail::raise_fire_error(
+      internal_try_fire(trigger, args...), representation, trigger, on_unhandled_trigger_);
+  }
+
+  /// Implementation of state transition given a trigger, reporting errors by value.
+  template<typename... TArgs>
+  fire_result internal_try_fire(const TTrigger& trigger, const TArgs&... args)
+  {
+    cursor c = { this };
+    return detail::try_fire(configuration_, c, current_, trigger, args...);
+  }
+
+  /// Implementation for public print and stream operator.
+  void print(std::ostream& os) const
+  {
+    os << "state_machine { state = ";
+    print_state<TState>(os, state());
+    os << ", permitted triggers = { ";
+    bool first = true;
+    for_each_permitted_trigger([&](const TTrigger& pt)
+      {
+        if (!first) os << ", ";
+        first = false;
+        print_trigger<TTrigger>(os, pt);
+      });
+    os << " } }";
+  }
+
+  /// The configured states and trigger parameters.
+  TConfiguration configuration_;
+
+  /// Triggers queued by any thread to be fired by the owning thread.
+  detail::lazy_mpsc_queue<TTrigger> deferred_triggers_;
+
+  /// Representation of the current state.
+  const TStateRepresentation* current_;
+
+  /// Function to call on unhandled trigger.
+  TUnhandledTriggerAction on_unhandled_trigger_;
+
+  /// Function to call on state transition.
+  TTransitionAction on_transition_;
+};
+
+}
+
+#endif // STATELESS_ENUM_STATE_MACHINE_HPP
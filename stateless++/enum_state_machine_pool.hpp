@@ -0,0 +1,593 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_ENUM_STATE_MACHINE_POOL_HPP
+#define STATELESS_ENUM_STATE_MACHINE_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "detail/enum_configuration.hpp"
+#include "detail/firing.hpp"
+#include "detail/transition_core.hpp"
+#include "detail/transition_kernel.hpp"
+#include "error.hpp"
+#include "fire_result.hpp"
+#include "inplace_function.hpp"
+#include "state_configuration.hpp"
+#include "trigger_with_parameters.hpp"
+
+namespace stateless
+{
+
+/**
+ * The states of many instances of one machine over enumerated states, stored
+ * as an array of small integers so that a trigger can be applied to all of
+ * them by a vectorized table lookup.
+ *
+ * Offers the same configuration interface as enum_state_machine, and fires
+ * triggers on one instance the same way. freeze()
+ * resolves, for every state and trigger, the transitions configured with
+ * permit() and ignore() that have no guard into a table of next states.
+ * fire_all_instances() uses that table to find the instances whose state
+ * changes and runs the exit and entry actions of those instances only.
+ * Instances whose state has a guarded, dynamic, reentrant or missing
+ * behaviour for the trigger are fired one at a time, as by try_fire().
+ *
+ * \tparam TState The enumeration used to represent the states. Its enumerators
+ *                must be the consecutive values 0 to NStates - 1.
+ * \tparam TTrigger The enumeration used to represent the triggers. Its enumerators
+ *                  must be the consecutive values 0 to NTriggers - 1.
+ * \tparam NStates The number of states, at most 65536.
+ * \tparam NTriggers The number of triggers.
+ */
+template<typename TState, typename TTrigger, std::size_t NStates, std::size_t NTriggers>
+class enum_state_machine_pool
+{
+  static_assert(std::is_enum<TState>::value, "The state type must be an enumeration.");
+  static_assert(std::is_enum<TTrigger>::value, "The trigger type must be an enumeration.");
+  static_assert(NStates <= 65536, "The states must fit in 16 bits.");
+
+public:
+  /// Parameterized state configuration type.
+  typedef state_configuration<TState, TTrigger> TStateConfiguration;
+
+  /// Parameterized transition type.
+  typedef typename TStateConfiguration::TTransition TTransition;
+
+  /// Parameterized trigger with parameters type.
+  typedef typename TStateConfiguration::TTriggerWithParameters TTriggerWithParameters;
+
+  /// Integer type in which the state of each instance is stored.
+  typedef typename std::conditional<
+    NStates <= 256, std::uint8_t, std::uint16_t>::type TStateStorage;
+
+  /// Signature for handler for the transition of an instance, given its identifier.
+  typedef inplace_function<void(std::size_t, const TTransition&)> TInstanceTransitionAction;
+
+  /**
+   * Construct a pool of instances that are all in the same state.
+   * No entry actions are invoked.
+   *
+   * \param size The number of instances.
+   * \param initial_state The initial state of every instance.
+   */
+  enum_state_machine_pool(std::size_t size, const TState& initial_state)
+    : configuration_()
+    , next_()
+    , states_()
+    , frozen_(false)
+    , on_transition_()
+  {
+    states_.assign(size, storage(initial_state));
+  }
+
+  /**
+   * Begin configuration of the entry/exit actions and allowed transitions
+   * when an instance is in a particular state.
+   *
+   * \param state The state to configure.
+   *
+   * \return A configuration object through which the state can be configured.
+   *
+   * \throw error The pool has been frozen.
+   */
+  TStateConfiguration configure(const TState& state)
+  {
+    enforce_not_frozen();
+    return configuration_.configure(state);
+  }
+
+  /**
+   * Specify the arguments that must be supplied when a specific trigger is fired.
+   *
+   * \param trigger The underlying trigger value.
+   *
+   * \return An object that can be passed to try_fire() in order to fire the
+   *         parameterised trigger.
+   *
+   * \throw error The pool has been frozen.
+   */
+  template<typename... TArgs>
+  std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>
+  set_trigger_parameters(const TTrigger& trigger)
+  {
+    enforce_not_frozen();
+    return configuration_.template set_trigger_parameters<TArgs...>(trigger);
+  }
+
+  /**
+   * Register a callback that will be invoked after each instance transitions,
+   * once its entry actions have run.
+   *
+   * \param action The action to execute, accepting the identifier of the
+   *               instance and the details of the transition.
+   */
+  void on_transition(const TInstanceTransitionAction& action)
+  {
+    on_transition_ = action;
+  }
+
+  /**
+   * Finish configuration and compile the table of next states used by
+   * fire_all_instances().
+   *
+   * \throw error The pool has already been frozen.
+   *
+   * \note Transitions configured with permit() and ignore() must not depend on
+   *       anything but the configuration, which is the case for the behaviours
+   *       state_configuration creates.
+   */
+  void freeze()
+  {
+    enforce_not_frozen();
+    next_.assign(NTriggers * NStates, no_transition);
+    for (std::size_t t = 0; t < NTriggers; ++t)
+    {
+      const auto configuration =
+        configuration_.trigger_parameters(static_cast<TTrigger>(t), t);
+      if (configuration != nullptr && configuration->signature() != detail::signature<>::id())
+      {
+        // Firing without arguments reports bad parameters.
+        continue;
+      }
+      for (std::size_t s = 0; s < NStates; ++s)
+      {
+        next_[t * NStates + s] = resolve_next(s, t);
+      }
+    }
+    frozen_ = true;
+  }
+
+  /// Determine whether the pool has been frozen.
+  bool is_frozen() const
+  {
+    return frozen_;
+  }
+
+  /// The number of instances.
+  std::size_t size() const
+  {
+    return states_.size();
+  }
+
+  /**
+   * Append an instance. No entry actions are invoked.
+   *
+   * \param initial_state The initial state of the instance.
+   *
+   * \return The identifier of the new instance.
+   */
+  std::size_t add(const TState& initial_state)
+  {
+    states_.push_back(storage(initial_state));
+    return states_.size() - 1;
+  }
+
+  /**
+   * The current state of an instance.
+   *
+   * \throw error The identifier is not that of an instance of the pool.
+   */
+  TState state(std::size_t id) const
+  {
+    return static_cast<TState>(states_[checked_id(id)]);
+  }
+
+  /**
+   * Determine whether an instance is in the supplied state.
+   *
+   * \return True if its current state is equal to, or a substate of, the supplied state.
+   *
+   * \throw error The identifier is not that of an instance of the pool.
+   */
+  bool is_in_state(std::size_t id, const TState& state) const
+  {
+    return configuration_.representation(states_[checked_id(id)])->is_included_in(state);
+  }
+
+  /**
+   * Transition one instance via the supplied trigger, reporting failures in
+   * the returned value.
+   *
+   * \param id The identifier of the instance.
+   * \param trigger The trigger to fire.
+   *
+   * \return The outcome of firing the trigger.
+   *
+   * \throw error The identifier is not that of an instance of the pool.
+   */
+  fire_result try_fire(std::size_t id, const TTrigger& trigger)
+  {
+    return internal_try_fire(checked_id(id), trigger);
+  }
+
+  /**
+   * Transition one instance via the supplied trigger, reporting failures in
+   * the returned value.
+   *
+   * \param id The identifier of the instance.
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \return The outcome of firing the trigger.
+   *
+   * \throw error The identifier is not that of an instance of the pool.
+   */
+  template<typename... TArgs, typename... TParams>
+  fire_result try_fire(
+    std::size_t id,
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args)
+  {
+    return internal_try_fire<TArgs...>(
+      checked_id(id), trigger->trigger(), std::forward<TParams>(args)...);
+  }
+
+  /**
+   * Fire a trigger on every instance in order of identifier.
+   *
+   * The instances are scanned in chunks with the widest instruction set the
+   * processor supports, and only those whose state the trigger changes, or
+   * that need guards or decisions evaluated, are fired individually.
+   *
+   * Actions may fire other instances of the pool. An instance that an action
+   * moves after its chunk was scanned is fired in its new state if the scan
+   * selected it, and is otherwise left as it is.
+   *
+   * \param trigger The trigger to fire.
+   * \param policy Whether to stop at the first instance that does not handle the trigger.
+   *
+   * \return The number of instances the trigger was fired on and the number
+   *         that did not handle it, and the last outcome.
+   *
+   * \throw error The pool is not frozen.
+   */
+  batch_result fire_all_instances(
+    const TTrigger& trigger,
+    batch_policy policy = batch_policy::continue_on_failure)
+  {
+    return fire_all_instances(trigger, policy, detail::detected_simd_level());
+  }
+
+  /**
+   * Fire one trigger on each of a sequence of instances. The n-th trigger is
+   * fired on the n-th instance; an instance may appear more than once.
+   *
+   * \param first_id The identifier of the first instance.
+   * \param last_id One past the identifier of the last instance.
+   * \param first_trigger The trigger to fire on the first instance.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   *
+   * \throw error An identifier is not that of an instance of the pool. The
+   *              triggers before it have been fired.
+   */
+  template<typename TIdIterator, typename TTriggerIterator>
+  batch_result fire(
+    TIdIterator first_id,
+    TIdIterator last_id,
+    TTriggerIterator first_trigger,
+    batch_policy policy = batch_policy::continue_on_failure)
+  {
+    batch_result result = { 0, 0, fire_result::ignored };
+    for (; first_id != last_id; ++first_id, ++first_trigger)
+    {
+      const auto outcome = internal_try_fire(checked_id(*first_id), *first_trigger);
+      if (!detail::record_batch_outcome(result, outcome, policy))
+      {
+        break;
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Fire one trigger on each of a sequence of instances, given as ranges
+   * such as arrays or vectors.
+   *
+   * \param ids The identifiers of the instances.
+   * \param triggers The triggers to fire, one for each identifier.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   *
+   * \throw error The ranges differ in length, or an identifier is not that
+   *              of an instance of the pool.
+   */
+  template<typename TIds, typename TTriggers>
+  batch_result fire(
+    const TIds& ids,
+    const TTriggers& triggers,
+    batch_policy policy = batch_policy::continue_on_failure)
+  {
+    if (std::distance(std::begin(ids), std::end(ids))
+      != std::distance(std::begin(triggers), std::end(triggers)))
+    {
+      raise_error("The number of instance identifiers and triggers must be equal.");
+    }
+    return fire(std::begin(ids), std::end(ids), std::begin(triggers), policy);
+  }
+
+  /**
+   * Fire a trigger on every instance with a particular instruction set.
+   * Exposed so that the vectorized and scalar kernels can be compared.
+   *
+   * \param trigger The trigger to fire.
+   * \param policy Whether to stop at the first instance that does not handle the trigger.
+   * \param level The instruction set to use, which the processor must support.
+   */
+  batch_result fire_all_instances(
+    const TTrigger& trigger, batch_policy policy, detail::simd_level level)
+  {
+    if (!frozen_)
+    {
+      raise_error("The pool must be frozen to fire a trigger on all instances.");
+    }
+
+    batch_result result = { 0, 0, fire_result::ignored };
+    if (states_.empty())
+    {
+      // Nothing is fired, as by fire() given no triggers.
+      return result;
+    }
+
+    const auto t = index(trigger);
+    if (t >= NTriggers)
+    {
+      result.consumed = policy == batch_policy::stop_on_failure ? 1 : states_.size();
+      result.failed = result.consumed;
+      result.last_result = fire_result::unhandled;
+      return result;
+    }
+
+    const auto next = &next_[t * NStates];
+    // Local, so that actions may fire the pool again while a chunk is in progress.
+    std::array<std::uint32_t, chunk_size> changed;
+    bool last_fired = false;
+    for (std::size_t base = 0; base < states_.size(); base += chunk_size)
+    {
+      const auto count = states_.size() - base < chunk_size ? states_.size() - base : chunk_size;
+      const auto n = detail::select_changed(
+        level, states_.data() + base, count, next, NStates, changed.data());
+      for (std::size_t k = 0; k < n; ++k)
+      {
+        const auto id = base + changed[k];
+        result.last_result = fire_changed(id, trigger, next);
+        last_fired = id == states_.size() - 1;
+        if (!is_handled(result.last_result))
+        {
+          ++result.failed;
+          if (policy == batch_policy::stop_on_failure)
+          {
+            result.consumed = id + 1;
+            return result;
+          }
+        }
+      }
+    }
+
+    result.consumed = states_.size();
+    if (!last_fired)
+    {
+      // The last instance was left in its state by an unguarded ignore().
+      result.last_result = fire_result::ignored;
+    }
+    return result;
+  }
+
+private:
+  enum_state_machine_pool(const enum_state_machine_pool&);
+  enum_state_machine_pool& operator=(const enum_state_machine_pool&);
+
+  /// Parameterized configuration type.
+  typedef detail::enum_configuration<TState, TTrigger, NStates, NTriggers> TConfiguration;
+
+  /// Parameterized state representation type.
+  typedef typename TConfiguration::TStateRepresentation TStateRepresentation;
+
+  /// Where try_fire() keeps the current state: the storage of one instance.
+  struct cursor
+  {
+    std::size_t instance_id() const
+    {
+      return id;
+    }
+
+    void set_current(const TStateRepresentation* representation)
+    {
+      pool->states_[id] = static_cast<TStateStorage>(index(representation->underlying_state()));
+    }
+
+    void transitioned(const TTransition& transition)
+    {
+    }
+
+    void entered(const TTransition& transition)
+    {
+      if (pool->on_transition_)
+      {
+        pool->on_transition_(id, transition);
+      }
+    }
+
+    enum_state_machine_pool* pool;
+    std::size_t id;
+  };
+
+  /// Number of instances scanned by the kernel at a time.
+  static const std::size_t chunk_size = 4096;
+
+  /// Entry of the table of next states for an instance that must be fired individually.
+  static const std::uint32_t no_transition = 0xFFFFFFFF;
+
+  template<typename TEnum>
+  static std::size_t index(const TEnum& value)
+  {
+    return TConfiguration::index(value);
+  }
+
+  void enforce_not_frozen() const
+  {
+    if (frozen_)
+    {
+      raise_error("The pool is frozen and cannot be reconfigured.");
+    }
+  }
+
+  /// Check that an identifier is that of an instance of the pool.
+  std::size_t checked_id(std::size_t id) const
+  {
+    if (id >= states_.size())
+    {
+      raise_error("The instance identifier is outside the pool.");
+    }
+    return id;
+  }
+
+  /// The stored form of a state.
+  TStateStorage storage(const TState& state) const
+  {
+    const auto s = index(state);
+    if (s >= NStates)
+    {
+      raise_error("The state is outside the range of the state machine.");
+    }
+    return static_cast<TStateStorage>(s);
+  }
+
+  /**
+   * The next state of a state when a trigger is fired, if it is resolved by a
+   * single unguarded behaviour configured with permit() or ignore() on the
+   * state or its nearest superstate that handles the trigger.
+   *
+   * \return The next state, or no_transition.
+   */
+  std::uint32_t resolve_next(std::size_t s, std::size_t t) const
+  {
+    for (auto representation = configuration_.representation(s);
+         representation != nullptr;
+         representation = representation->super_state_representation())
+    {
+      const auto& candidates =
+        configuration_.candidates(index(representation->underlying_state()), t);
+      if (candidates.empty())
+      {
+        continue;
+      }
+      if (candidates.size() != 1 ||
+          candidates.front()->is_guarded() ||
+          candidates.front()->signature() != nullptr)
+      {
+        return no_transition;
+      }
+      const auto source = static_cast<TState>(s);
+      TState destination;
+      if (!candidates.front()->results_in_transition_from(source, destination))
+      {
+        return static_cast<std::uint32_t>(s);
+      }
+      // Reentry runs actions without changing state, so it is fired individually.
+      return destination == source ? no_transition : static_cast<std::uint32_t>(index(destination));
+    }
+    return no_transition;
+  }
+
+  /// Fire a trigger on an instance the kernel reported, using the table when it can.
+  fire_result fire_changed(std::size_t id, const TTrigger& trigger, const std::uint32_t* next)
+  {
+    // Read again, as an action may have moved the instance since its chunk was scanned.
+    const auto current = states_[id];
+    const auto destination = next[current];
+    if (destination == no_transition)
+    {
+      return internal_try_fire(id, trigger);
+    }
+    if (destination == current)
+    {
+      return fire_result::ignored;
+    }
+    const auto source = configuration_.representation(current);
+    const auto destination_representation = configuration_.representation(destination);
+    const TTransition transition(
+      source->underlying_state(), destination_representation->underlying_state(), trigger, id);
+    cursor c = { this, id };
+    detail::transition_to(c, source, destination_representation, transition);
+    return fire_result::transitioned;
+  }
+
+  /// Implementation of state transition of one instance, reporting errors by value.
+  template<typename... TArgs>
+  fire_result internal_try_fire(std::size_t id, const TTrigger& trigger, const TArgs&... args)
+  {
+    cursor c = { this, id };
+    return detail::try_fire(
+      configuration_, c, configuration_.representation(states_[id]), trigger, args...);
+  }
+
+  /// The configured states and trigger parameters.
+  TConfiguration configuration_;
+
+  /// The next state of each state, indexed by trigger * NStates + state; compiled by freeze().
+  std::vector<std::uint32_t> next_;
+
+  /// The state of each instance, indexed by identifier.
+  std::vector<TStateStorage> states_;
+
+  /// Whether configuration is finished and the table is in use.
+  bool frozen_;
+
+  /// Function to call after an instance transitions.
+  TInstanceTransitionAction on_transition_;
+};
+
+template<typename TState, typename TTrigger, std::size_t NStates, std::size_t NTriggers>
+const std::size_t enum_state_machine_pool<TState, TTrigger, NStates, NTriggers>::chunk_size;
+
+template<typename TState, typename TTrigger, std::size_t NStates, std::size_t NTriggers>
+const std::uint32_t enum_state_machine_pool<TState, TTrigger, NStates, NTriggers>::no_transition;
+
+}
+
+#endif // STATELESS_ENUM_STATE_MACHINE_POOL_HPP
@@ -17,8 +17,17 @@
 #ifndef STATELESS_ERROR_HPP
 #define STATELESS_ERROR_HPP
 
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
 
+// Detect builds without exception support, e.g. -fno-exceptions.
+#if !defined(STATELESS_NO_EXCEPTIONS) && \
+    !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#define STATELESS_NO_EXCEPTIONS
+#endif
+
 namespace stateless
 {
 
@@ -33,6 +42,58 @@ public:
   {}
 };
 
+/**
+ * Signature of a function handling errors raised by the library.
+ * The handler must not return; if it does, the program is aborted.
+ */
+typedef void (*error_handler)(const char* what);
+
+namespace detail
+{
+
+/// The default error handler throws error, or aborts without exception support.
+inline void default_error_handler(const char* what)
+{
+#ifdef STATELESS_NO_EXCEPTIONS
+  std::fprintf(stderr, "stateless++ error: %s\n", what);
+  std::abort();
+#else
+  throw error(what);
+#endif
+}
+
+inline std::atomic<error_handler>& installed_error_handler()
+{
+  static std::atomic<error_handler> handler(&default_error_handler);
+  return handler;
+}
+
+}
+
+/**
+ * Install the function called when the library raises an error.
+ *
+ * \param handler The handler, or nullptr to restore the default handler.
+ *
+ * \return The previously installed handler.
+ */
+inline error_handler set_error_handler(error_handler handler)
+{
+  return detail::installed_error_handler().exchange(
+    handler == nullptr ? &detail::default_error_handler : handler);
+}
+
+/**
+ * Report an error through the installed error handler.
+ *
+ * \param what Description of the error.
+ */
+[[noreturn]] inline void raise_error(const char* what)
+{
+  detail::installed_error_handler().load()(what);
+  std::abort();
+}
+
 }
 
 #endif // STATELESS_ERROR_HPP
@@ -0,0 +1,94 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_FIRE_RESULT_HPP
+#define STATELESS_FIRE_RESULT_HPP
+
+#include <cstddef>
+
+namespace stateless
+{
+
+/**
+ * The outcome of firing a trigger with try_fire().
+ */
+enum class fire_result
+{
+  /// The trigger caused a transition, possibly back into the current state.
+  transitioned,
+
+  /// The trigger was handled without causing a transition.
+  ignored,
+
+  /// No behaviour whose guard condition is met handles the trigger in the current state.
+  unhandled,
+
+  /// More than one behaviour for the trigger has its guard condition met.
+  guard_conflict,
+
+  /// The arguments do not match the parameters configured for the trigger.
+  bad_parameters
+};
+
+/// Determine whether a trigger was handled, with or without a transition.
+inline bool is_handled(fire_result result)
+{
+  return result == fire_result::transitioned || result == fire_result::ignored;
+}
+
+/**
+ * How fire_all() proceeds after a trigger that is not handled.
+ */
+enum class batch_policy
+{
+  /// Stop at the first trigger that is not handled.
+  stop_on_failure,
+
+  /// Skip triggers that are not handled and fire the rest.
+  continue_on_failure
+};
+
+/**
+ * The outcome of firing a sequence of triggers with fire_all().
+ */
+struct batch_result
+{
+  /// Number of triggers consumed, including a trigger the batch stopped at.
+  std::size_t consumed;
+
+  /// Number of consumed triggers that were not handled.
+  std::size_t failed;
+
+  /// Outcome of the last consumed trigger, or ignored if none was consumed.
+  fire_result last_result;
+};
+
+/**
+ * An instance of a pool that did not handle a trigger fired in bulk.
+ */
+struct instance_failure
+{
+  /// The identifier of the instance.
+  std::size_t id;
+
+  /// Why the trigger was not handled.
+  fire_result result;
+};
+
+}
+
+#endif // STATELESS_FIRE_RESULT_HPP
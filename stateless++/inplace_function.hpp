@@ -0,0 +1,232 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_INPLACE_FUNCTION_HPP
+#define STATELESS_INPLACE_FUNCTION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "error.hpp"
+
+/**
+ * Default capacity, in bytes, of the callables stored by a state machine.
+ *
+ * Define before including any stateless++ header to store larger captures.
+ */
+#ifndef STATELESS_INPLACE_FUNCTION_CAPACITY
+#define STATELESS_INPLACE_FUNCTION_CAPACITY 64
+#endif
+
+namespace stateless
+{
+
+template<typename TSignature, std::size_t Capacity = STATELESS_INPLACE_FUNCTION_CAPACITY>
+class inplace_function;
+
+/**
+ * Polymorphic function wrapper that never allocates.
+ *
+ * The wrapped callable is stored in a buffer of Capacity bytes inside the
+ * wrapper itself. Wrapping a callable that does not fit is a compile error.
+ *
+ * \tparam TResult The result type of the signature.
+ * \tparam TArgs The argument types of the signature.
+ * \tparam Capacity The size of the buffer in which the callable is stored.
+ */
+template<typename TResult, typename... TArgs, std::size_t Capacity>
+class inplace_function<TResult(TArgs...), Capacity>
+{
+public:
+  /// Construct an empty function.
+  inplace_function()
+    : operations_(&empty_operations)
+  {}
+
+  /// Construct an empty function.
+  inplace_function(std::nullptr_t)
+    : operations_(&empty_operations)
+  {}
+
+  /// Construct a function wrapping the supplied callable.
+  template<
+    typename TCallable,
+    typename = typename std::enable_if<
+      !std::is_same<typename std::decay<TCallable>::type, inplace_function>::value>::type>
+  inplace_function(TCallable&& callable)
+    : operations_(&callable_operations<typename std::decay<TCallable>::type>::value)
+  {
+    typedef typename std::decay<TCallable>::type TStored;
+    static_assert(
+      sizeof(TStored) <= Capacity,
+      "The callable is too large for the inplace_function. Capture less state or "
+      "define STATELESS_INPLACE_FUNCTION_CAPACITY to a larger value.");
+    static_assert(
+      alignof(TStored) <= alignof(TStorage),
+      "The callable is over-aligned for the inplace_function.");
+    new (&storage_) TStored(std::forward<TCallable>(callable));
+  }
+
+  inplace_function(const inplace_function& other)
+    : operations_(other.operations_)
+  {
+    operations_->copy(&storage_, &other.storage_);
+  }
+
+  inplace_function(inplace_function&& other)
+    : operations_(other.operations_)
+  {
+    operations_->move(&storage_, &other.storage_);
+  }
+
+  ~inplace_function()
+  {
+    operations_->destroy(&storage_);
+  }
+
+  inplace_function& operator=(const inplace_function& other)
+  {
+    if (this != &other)
+    {
+      operations_->destroy(&storage_);
+      operations_ = &empty_operations;
+      other.operations_->copy(&storage_, &other.storage_);
+      operations_ = other.operations_;
+    }
+    return *this;
+  }
+
+  inplace_function& operator=(inplace_function&& other)
+  {
+    if (this != &other)
+    {
+      operations_->destroy(&storage_);
+      operations_ = &empty_operations;
+      other.operations_->move(&storage_, &other.storage_);
+      operations_ = other.operations_;
+    }
+    return *this;
+  }
+
+  /**
+   * Invoke the wrapped callable.
+   *
+   * \throw std::bad_function_call The function is empty. Without exception
+   *        support the error is raised through the error handler instead.
+   */
+  TResult operator()(TArgs... args) const
+  {
+    return operations_->invoke(&storage_, std::forward<TArgs>(args)...);
+  }
+
+  /// Determine whether the function wraps a callable.
+  explicit operator bool() const
+  {
+    return operations_ != &empty_operations;
+  }
+
+private:
+  typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type TStorage;
+
+  /// Type erased operations on the stored callable.
+  struct operations
+  {
+    TResult (*invoke)(void*, TArgs&&...);
+    void (*copy)(void*, const void*);
+    void (*move)(void*, void*);
+    void (*destroy)(void*);
+  };
+
+  static TResult invoke_empty(void*, TArgs&&...)
+  {
+#ifdef STATELESS_NO_EXCEPTIONS
+    raise_error("Call of an empty inplace_function.");
+#else
+    throw std::bad_function_call();
+#endif
+  }
+
+  static void copy_empty(void*, const void*) {}
+
+  static void move_empty(void*, void*) {}
+
+  static void destroy_empty(void*) {}
+
+  static const operations empty_operations;
+
+  template<typename TStored>
+  static TResult invoke_callable(void* callable, TArgs&&... args)
+  {
+    return static_cast<TResult>(
+      (*static_cast<TStored*>(callable))(std::forward<TArgs>(args)...));
+  }
+
+  template<typename TStored>
+  static void copy_callable(void* destination, const void* source)
+  {
+    new (destination) TStored(*static_cast<const TStored*>(source));
+  }
+
+  template<typename TStored>
+  static void move_callable(void* destination, void* source)
+  {
+    new (destination) TStored(std::move(*static_cast<TStored*>(source)));
+  }
+
+  template<typename TStored>
+  static void destroy_callable(void* callable)
+  {
+    static_cast<TStored*>(callable)->~TStored();
+  }
+
+  template<typename TStored>
+  struct callable_operations
+  {
+    static const operations value;
+  };
+
+  const operations* operations_;
+  mutable TStorage storage_;
+};
+
+template<typename TResult, typename... TArgs, std::size_t Capacity>
+const typename inplace_function<TResult(TArgs...), Capacity>::operations
+inplace_function<TResult(TArgs...), Capacity>::empty_operations =
+{
+  &inplace_function::invoke_empty,
+  &inplace_function::copy_empty,
+  &inplace_function::move_empty,
+  &inplace_function::destroy_empty
+};
+
+template<typename TResult, typename... TArgs, std::size_t Capacity>
+template<typename TStored>
+const typename inplace_function<TResult(TArgs...), Capacity>::operations
+inplace_function<TResult(TArgs...), Capacity>::callable_operations<TStored>::value =
+{
+  &inplace_function::template invoke_callable<TStored>,
+  &inplace_function::template copy_callable<TStored>,
+  &inplace_function::template move_callable<TStored>,
+  &inplace_function::template destroy_callable<TStored>
+};
+
+}
+
+#endif // STATELESS_INPLACE_FUNCTION_HPP
@@ -0,0 +1,571 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_MACHINE_DEFINITION_HPP
+#define STATELESS_MACHINE_DEFINITION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <utility>
+
+#include "container_policy.hpp"
+#include "error.hpp"
+#include "fire_result.hpp"
+#include "inplace_function.hpp"
+#include "state_configuration.hpp"
+#include "detail/firing.hpp"
+#include "detail/machine_configuration.hpp"
+#include "detail/mpsc_queue.hpp"
+#include "detail/transition_core.hpp"
+#include "trigger_with_parameters.hpp"
+
+namespace stateless
+{
+
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+class machine_definition;
+
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+class state_machine_pool;
+
+/**
+ * The runtime state of one state machine whose configuration is held by a
+ * machine_definition. An instance is the size of a pointer, may be copied
+ * freely and is only valid while its definition exists.
+ *
+ * Actions shared through the definition tell instances apart by the
+ * instance_id() of a transition, which is the address of the instance fired
+ * as a std::uintptr_t, or its identifier when fired through a
+ * state_machine_pool.
+ *
+ * Instances are created by machine_definition::create_instance().
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class machine_instance
+{
+public:
+  /// The current state.
+  const TState& state() const
+  {
+    return current_->underlying_state();
+  }
+
+private:
+  friend class machine_definition<TState, TTrigger, TContainerPolicy>;
+
+  /// Parameterized state representation type.
+  typedef detail::state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
+
+  explicit machine_instance(const TStateRepresentation* current)
+    : current_(current)
+  {}
+
+  /// Representation of the current state, owned by the definition.
+  const TStateRepresentation* current_;
+};
+
+/**
+ * A machine_instance that also owns a queue of deferred triggers. Any thread
+ * may defer a trigger; the thread that owns the instance fires them with
+ * machine_definition::drain_deferred_triggers().
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class deferred_machine_instance : public machine_instance<TState, TTrigger, TContainerPolicy>
+{
+public:
+  /// Parameterized instance type.
+  typedef machine_instance<TState, TTrigger, TContainerPolicy> TInstance;
+
+  /**
+   * Construct an instance with an empty queue of deferred triggers.
+   *
+   * \param instance The instance whose current state is copied.
+   */
+  explicit deferred_machine_instance(const TInstance& instance)
+    : TInstance(instance)
+    , deferred_triggers_(STATELESS_DEFERRED_TRIGGER_CAPACITY)
+  {}
+
+  /**
+   * Queue a trigger to be fired later by the thread that owns the instance.
+   * May be called from any thread; it never blocks, and only the first
+   * trigger queued allocates the queue.
+   *
+   * \param trigger The trigger to queue.
+   *
+   * \return False if the queue is full, in which case the trigger is dropped.
+   */
+  bool push_deferred_trigger(const TTrigger& trigger)
+  {
+    return deferred_triggers_.push(trigger);
+  }
+
+private:
+  friend class machine_definition<TState, TTrigger, TContainerPolicy>;
+
+  /// Triggers queued by any thread to be fired by the owning thread.
+  detail::lazy_mpsc_queue<TTrigger> deferred_triggers_;
+};
+
+/**
+ * The immutable configuration of a state machine, shared by any number of
+ * machine_instance objects that hold nothing but their current state.
+ *
+ * The definition is configured like a state_machine and then frozen, after
+ * which instances can be created and fired. Because the definition is never
+ * modified once frozen, its const methods may be called from any number of
+ * threads at once, provided each instance is fired by one thread at a time
+ * and guards and actions are themselves safe to call concurrently.
+ *
+ * \tparam TState The type used to represent the states.
+ * \tparam TTrigger The type used to represent the triggers that cause state transitions.
+ * \tparam TContainerPolicy The policy selecting the containers used to look up states
+ *                          and triggers; see container_policy.hpp.
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class machine_definition
+{
+public:
+  /// Parameterized state configuration type.
+  typedef state_configuration<TState, TTrigger, TContainerPolicy> TStateConfiguration;
+
+  /// Parameterized transition type.
+  typedef typename TStateConfiguration::TTransition TTransition;
+
+  /// Parameterized trigger with parameters type.
+  typedef typename TStateConfiguration::TTriggerWithParameters TTriggerWithParameters;
+
+  /// Parameterized instance type.
+  typedef machine_instance<TState, TTrigger, TContainerPolicy> TInstance;
+
+  /// Parameterized instance type with a queue of deferred triggers.
+  typedef deferred_machine_instance<TState, TTrigger, TContainerPolicy> TDeferredInstance;
+
+  /// Signature for handler for unhandled trigger. By default this throws an error.
+  typedef inplace_function<void(const TState&, const TTrigger&)> TUnhandledTriggerAction;
+
+  /// Signature for handler for state transition. Does nothing by default.
+  typedef inplace_function<void(const TTransition&)> TTransitionAction;
+
+  machine_definition()
+  {
+    on_unhandled_trigger_ = &detail::raise_unhandled_trigger<TState, TTrigger>;
+  }
+
+  machine_definition(const machine_definition&) = delete;
+  machine_definition& operator=(const machine_definition&) = delete;
+
+  /**
+   * Begin configuration of the entry/exit actions and allowed transitions
+   * when a machine is in a particular state.
+   *
+   * \param state The state to configure.
+   *
+   * \return A configuration object through which the state can be configured.
+   *
+   * \throw error The definition has been frozen.
+   */
+  TStateConfiguration configure(const TState& state)
+  {
+    enforce_not_frozen();
+    return configuration_.configure(state);
+  }
+
+  /**
+   * Specify the arguments that must be supplied when a specific trigger is fired.
+   *
+   * \param trigger The underlying trigger value.
+   *
+   * \return An object that can be passed to fire() in order to fire the
+   *         parameterised trigger.
+   *
+   * \throw error The definition has been frozen.
+   */
+  template<typename... TArgs>
+  std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>
+  set_trigger_parameters(const TTrigger& trigger)
+  {
+    enforce_not_frozen();
+    return configuration_.template set_trigger_parameters<TArgs...>(trigger);
+  }
+
+  /**
+   * Register a callback that will be invoked every time an instance
+   * transitions from one state into another.
+   *
+   * \param action The action to execute, accepting the details of the transition.
+   *               The instance is identified by the instance_id() of the transition.
+   *
+   * \throw error The definition has been frozen.
+   */
+  void on_transition(const TTransitionAction& action)
+  {
+    enforce_not_frozen();
+    on_transition_ = action;
+  }
+
+  /**
+   * Override the default behaviour of throwing an exception when an
+   * unhandled trigger is fired.
+   *
+   * \param action An action to call when an unhandled trigger is fired.
+   *
+   * \throw error The definition has been frozen.
+   */
+  void on_unhandled_trigger(const TUnhandledTriggerAction& action)
+  {
+    enforce_not_frozen();
+    on_unhandled_trigger_ = action;
+  }
+
+  /**
+   * Finish configuration and compile the configured states into a flat
+   * transition table. The definition cannot be modified afterwards.
+   *
+   * \throw error The definition has already been frozen.
+   */
+  void freeze()
+  {
+    enforce_not_frozen();
+    configuration_.freeze();
+  }
+
+  /// Determine whether the definition has been frozen.
+  bool is_frozen() const
+  {
+    return configuration_.is_frozen();
+  }
+
+  /**
+   * Create an instance of the machine. No entry actions are invoked.
+   *
+   * \param initial_state The initial state.
+   *
+   * \throw error The definition is not frozen, or the state is not configured.
+   */
+  TInstance create_instance(const TState& initial_state) const
+  {
+    if (!configuration_.is_frozen())
+    {
+      raise_error("The machine definition must be frozen to create instances.");
+    }
+    return TInstance(configuration_.find_representation(initial_state));
+  }
+
+  /**
+   * Transition an instance from its current state via the supplied trigger.
+   *
+   * \param instance The instance to transition.
+   * \param trigger The trigger to fire.
+   *
+   * \throw error The current state does not allow the trigger to be fired.
+   */
+  void fire(TInstance& instance, const TTrigger& trigger) const
+  {
+    internal_fire(instance, trigger);
+  }
+
+  /**
+   * Transition an instance from its current state via the supplied trigger.
+   *
+   * \param instance The instance to transition.
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \throw error The current state does not allow the trigger to be fired.
+   */
+  template<typename... TArgs, typename... TParams>
+  void fire(
+    TInstance& instance,
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args) const
+  {
+    internal_fire<TArgs...>(instance, trigger->trigger(), std::forward<TParams>(args)...);
+  }
+
+  /**
+   * Transition an instance via the supplied trigger, reporting failures in
+   * the returned value rather than by throwing. The unhandled trigger action
+   * is not called.
+   *
+   * \param instance The instance to transition.
+   * \param trigger The trigger to fire.
+   *
+   * \return The outcome of firing the trigger.
+   */
+  fire_result try_fire(TInstance& instance, const TTrigger& trigger) const
+  {
+    return internal_try_fire(instance, trigger);
+  }
+
+  /**
+   * Transition an instance via the supplied trigger, reporting failures in
+   * the returned value rather than by throwing.
+   *
+   * \param instance The instance to transition.
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \return The outcome of firing the trigger.
+   */
+  template<typename... TArgs, typename... TParams>
+  fire_result try_fire(
+    TInstance& instance,
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args) const
+  {
+    return internal_try_fire<TArgs...>(
+      instance, trigger->trigger(), std::forward<TParams>(args)...);
+  }
+
+  /**
+   * Fire the deferred triggers of an instance in the order they were queued
+   * until none is left. Must only be called by the thread that owns the instance.
+   *
+   * \param instance The instance whose deferred triggers to fire.
+   * \param max_triggers The maximum number of triggers to fire.
+   *
+   * \return The number of triggers fired.
+   */
+  std::size_t drain_deferred_triggers(
+    TDeferredInstance& instance,
+    std::size_t max_triggers = static_cast<std::size_t>(-1)) const
+  {
+    return detail::drain_queue(
+      instance.deferred_triggers_, max_triggers, [&](const TTrigger& trigger)
+      {
+        internal_fire(instance, trigger);
+      });
+  }
+
+  /**
+   * Determine whether an instance is in the supplied state.
+   *
+   * \param instance The instance to test.
+   * \param state The state to test for.
+   *
+   * \return True if the current state is equal to, or a substate of, the supplied state.
+   */
+  bool is_in_state(const TInstance& instance, const TState& state) const
+  {
+    return instance.current_->is_included_in(state);
+  }
+
+  /**
+   * Determine whether the supplied trigger can be fired in the current state of an instance.
+   *
+   * \param instance The instance to test.
+   * \param trigger Trigger to test.
+   *
+   * \return True if the trigger can be fired, false otherwise.
+   */
+  bool can_fire(const TInstance& instance, const TTrigger& trigger) const
+  {
+    return configuration_.find_handler(instance.current_, trigger) != nullptr;
+  }
+
+  /**
+   * The trigger values currently permissible for an instance.
+   *
+   * \param instance The instance to query.
+   */
+  std::set<TTrigger> permitted_triggers(const TInstance& instance) const
+  {
+    return instance.current_->permitted_triggers();
+  }
+
+  /**
+   * Invoke a visitor with each trigger value currently permissible for an
+   * instance, without allocating.
+   *
+   * \param instance The instance to query.
+   * \param visitor Callable accepting a const TTrigger&.
+   */
+  template<typename TVisitor>
+  void for_each_permitted_trigger(const TInstance& instance, TVisitor visitor) const
+  {
+    instance.current_->for_each_permitted_trigger(visitor);
+  }
+
+private:
+  friend class state_machine_pool<TState, TTrigger, TContainerPolicy>;
+
+  /// Parameterized state representation type.
+  typedef detail::state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
+
+  /// Parameterized configuration type, the table of detail::try_fire().
+  typedef detail::machine_configuration<TState, TTrigger, TContainerPolicy> TConfiguration;
+
+  /// Action run after the entry actions of a transition that does nothing.
+  struct no_entered_action
+  {
+    void operator()(const TTransition&) const
+    {}
+  };
+
+  /**
+   * Cursor of detail::try_fire() over the current state of an instance.
+   * After the entry actions it calls an action supplied by the caller, such
+   * as the transition callback of a pool.
+   */
+  template<typename TEnteredAction>
+  struct cursor
+  {
+    std::size_t instance_id() const
+    {
+      return id;
+    }
+
+    void set_current(const TStateRepresentation* representation)
+    {
+      instance->current_ = representation;
+    }
+
+    void transitioned(const TTransition& transition)
+    {
+      if (definition->on_transition_)
+      {
+        definition->on_transition_(transition);
+      }
+    }
+
+    void entered(const TTransition& transition)
+    {
+      entered_action(transition);
+    }
+
+    const machine_definition* definition;
+    TInstance* instance;
+    std::size_t id;
+    TEnteredAction& entered_action;
+  };
+
+  /**
+   * Table of detail::try_fire() for a trigger whose identifier was looked up
+   * once for many instances.
+   */
+  struct known_trigger_table
+  {
+    std::size_t trigger_key(const TStateRepresentation*, const TTrigger&) const
+    {
+      return trigger_id;
+    }
+
+    const abstract_trigger_with_parameters<TTrigger>* trigger_parameters(
+      const TTrigger& trigger, std::size_t key) const
+    {
+      return configuration->trigger_parameters(trigger, key);
+    }
+
+    typename TConfiguration::TSelectedBehaviour find_handler(
+      const TStateRepresentation* representation,
+      const TTrigger& trigger,
+      std::size_t key,
+      bool& conflict) const
+    {
+      return configuration->find_handler(representation, trigger, key, conflict);
+    }
+
+    const TStateRepresentation* find_representation(const TState& state) const
+    {
+      return configuration->find_representation(state);
+    }
+
+    const TConfiguration* configuration;
+    std::size_t trigger_id;
+  };
+
+  void enforce_not_frozen() const
+  {
+    if (configuration_.is_frozen())
+    {
+      raise_error("The machine definition is frozen and cannot be reconfigured.");
+    }
+  }
+
+  /// The identifier of a trigger in the compiled table, or npos if it is not configured.
+  std::size_t trigger_id(const TTrigger& trigger) const
+  {
+    return configuration_.table().trigger_id(trigger);
+  }
+
+  /// Implementation of state transition given a trigger, reporting errors by throwing.
+  template<typename... TArgs>
+  void internal_fire(TInstance& instance, const TTrigger& trigger, const TArgs&... args) const
+  {
+    const auto representation = instance.current_;
+    detail::raise_fire_error(
+      internal_try_fire(instance, trigger, args...), representation, trigger, on_unhandled_trigger_);
+  }
+
+  /// Implementation of state transition given a trigger, reporting errors by value.
+  template<typename... TArgs>
+  fire_result internal_try_fire(
+    TInstance& instance, const TTrigger& trigger, const TArgs&... args) const
+  {
+    no_entered_action entered;
+    const auto id = static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(&instance));
+    cursor<no_entered_action> c = { this, &instance, id, entered };
+    return detail::try_fire(configuration_, c, instance.current_, trigger, args...);
+  }
+
+  /**
+   * Implementation of state transition given a trigger whose identifier has
+   * already been looked up, reporting errors by value.
+   *
+   * \param id The instance_id() of the transition.
+   * \param entered Called with the transition after its entry actions.
+   */
+  template<typename TEnteredAction, typename... TArgs>
+  fire_result internal_try_fire_id(
+    TInstance& instance,
+    std::size_t id,
+    std::size_t trigger_id,
+    const TTrigger& trigger,
+    TEnteredAction& entered,
+    const TArgs&... args) const
+  {
+    const known_trigger_table table = { &configuration_, trigger_id };
+    cursor<TEnteredAction> c = { this, &instance, id, entered };
+    return detail::try_fire(table, c, instance.current_, trigger, args...);
+  }
+
+  /// The configured states and the table compiled from them.
+  TConfiguration configuration_;
+
+  /// Function to call on unhandled trigger.
+  TUnhandledTriggerAction on_unhandled_trigger_;
+
+  /// Function to call on state transition.
+  TTransitionAction on_transition_;
+};
+
+}
+
+#endif // STATELESS_MACHINE_DEFINITION_HPP
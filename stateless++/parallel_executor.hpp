@@ -0,0 +1,313 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_PARALLEL_EXECUTOR_HPP
+#define STATELESS_PARALLEL_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "error.hpp"
+
+#ifndef STATELESS_NO_EXCEPTIONS
+#include <exception>
+#endif
+
+namespace stateless
+{
+
+/**
+ * A fixed set of worker threads that process the chunks of an index range
+ * in parallel.
+ *
+ * The chunks are split evenly into one contiguous share per participant,
+ * the calling thread included. Each participant claims chunks from the
+ * front of its own share and, when that is exhausted, steals the remaining
+ * chunks of the other shares, so uneven chunks still keep every thread busy.
+ * Claiming a chunk is a single atomic increment.
+ */
+class parallel_executor
+{
+public:
+  /// Number of instances per chunk when none is specified.
+  static const std::size_t default_chunk_size = 1024;
+
+  /**
+   * Start the worker threads.
+   *
+   * \param threads The number of threads taking part in each call, the
+   *                calling thread included, or zero for one per hardware thread.
+   */
+  explicit parallel_executor(std::size_t threads = 0)
+    : participants_(threads != 0 ? threads : hardware_threads())
+    , shares_(new share[participants_])
+    , workers_()
+    , mutex_()
+    , submit_mutex_()
+    , work_available_()
+    , work_finished_()
+    , job_(nullptr)
+    , generation_(0)
+    , stopping_(false)
+  {
+    for (std::size_t p = 1; p < participants_; ++p)
+    {
+      workers_.push_back(std::thread(&parallel_executor::work_loop, this, p));
+    }
+  }
+
+  /// Stop and join the worker threads.
+  ~parallel_executor()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (auto& worker : workers_)
+    {
+      worker.join();
+    }
+  }
+
+  parallel_executor(const parallel_executor&) = delete;
+  parallel_executor& operator=(const parallel_executor&) = delete;
+
+  /// The number of threads taking part in each call, the calling thread included.
+  std::size_t concurrency() const
+  {
+    return participants_;
+  }
+
+  /**
+   * Split the indices 0 to count into chunks and invoke a body for each chunk
+   * on the worker threads and the calling thread, returning once every chunk
+   * has been processed.
+   *
+   * Calls from different threads are serialized. The body must not call
+   * for_each_chunk() on the same executor.
+   *
+   * \param count The number of indices.
+   * \param chunk_size The maximum number of indices per chunk.
+   * \param body Callable accepting the chunk number and the first and one past
+   *             the last index of the chunk.
+   *
+   * \note If the body throws, chunks not yet claimed are skipped and the first
+   *       exception is rethrown in the calling thread.
+   */
+  template<typename TBody>
+  void for_each_chunk(std::size_t count, std::size_t chunk_size, TBody body)
+  {
+    if (chunk_size == 0)
+    {
+      raise_error("The chunk size must be positive.");
+    }
+    std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+
+    chunked_body<TBody> chunked = { &body, count, chunk_size };
+    job j(&chunked_body<TBody>::run, &chunked);
+    const auto chunks = (count + chunk_size - 1) / chunk_size;
+    for (std::size_t p = 0; p < participants_; ++p)
+    {
+      shares_[p].next.store(chunks * p / participants_, std::memory_order_relaxed);
+      shares_[p].end = chunks * (p + 1) / participants_;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &j;
+      ++generation_;
+    }
+    work_available_.notify_all();
+
+    work(j, 0);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_ = nullptr;
+      work_finished_.wait(lock, [&]{ return j.active == 0; });
+    }
+
+#ifndef STATELESS_NO_EXCEPTIONS
+    if (j.error)
+    {
+      std::rethrow_exception(j.error);
+    }
+#endif
+  }
+
+private:
+  /// The chunks of one participant, on a cache line of its own.
+  struct share
+  {
+    std::atomic<std::size_t> next;
+    std::size_t end;
+    char padding[64];
+  };
+
+  /// A call to for_each_chunk() in progress.
+  struct job
+  {
+    job(void (*run)(void*, std::size_t), void* body)
+      : run(run)
+      , body(body)
+      , active(0)
+      , aborted(false)
+    {}
+
+    void (*run)(void*, std::size_t);
+    void* body;
+
+    /// Number of worker threads working on the job, guarded by the executor mutex.
+    std::size_t active;
+
+    /// Set when the body has thrown, so that no further chunks are claimed.
+    std::atomic<bool> aborted;
+
+#ifndef STATELESS_NO_EXCEPTIONS
+    std::mutex error_mutex;
+    std::exception_ptr error;
+#endif
+  };
+
+  /// Adapts a body accepting chunk bounds to the type erased job.
+  template<typename TBody>
+  struct chunked_body
+  {
+    TBody* body;
+    std::size_t count;
+    std::size_t chunk_size;
+
+    static void run(void* self, std::size_t chunk)
+    {
+      const auto& b = *static_cast<chunked_body*>(self);
+      const auto first = chunk * b.chunk_size;
+      const auto last = b.count - first < b.chunk_size ? b.count : first + b.chunk_size;
+      (*b.body)(chunk, first, last);
+    }
+  };
+
+  static std::size_t hardware_threads()
+  {
+    const auto threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+  }
+
+  /// Process chunks of the own share, then steal from the other shares.
+  void work(job& j, std::size_t participant)
+  {
+    for (std::size_t k = 0; k < participants_; ++k)
+    {
+      auto& s = shares_[(participant + k) % participants_];
+      while (!j.aborted.load(std::memory_order_relaxed))
+      {
+        const auto chunk = s.next.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= s.end)
+        {
+          break;
+        }
+        run_chunk(j, chunk);
+      }
+    }
+  }
+
+  void run_chunk(job& j, std::size_t chunk)
+  {
+#ifdef STATELESS_NO_EXCEPTIONS
+    j.run(j.body, chunk);
+#else
+    try
+    {
+      j.run(j.body, chunk);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(j.error_mutex);
+      if (!j.error)
+      {
+        j.error = std::current_exception();
+      }
+      j.aborted.store(true, std::memory_order_relaxed);
+    }
+#endif
+  }
+
+  /// Body of a worker thread.
+  void work_loop(std::size_t participant)
+  {
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+      work_available_.wait(lock, [&]
+        {
+          return stopping_ || (job_ != nullptr && generation_ != seen);
+        });
+      if (stopping_)
+      {
+        return;
+      }
+      seen = generation_;
+      auto j = job_;
+      ++j->active;
+      lock.unlock();
+
+      work(*j, participant);
+
+      lock.lock();
+      if (--j->active == 0)
+      {
+        work_finished_.notify_all();
+      }
+    }
+  }
+
+  /// Number of threads taking part in each call, the calling thread included.
+  const std::size_t participants_;
+
+  /// The chunks of each participant in the current call.
+  std::unique_ptr<share[]> shares_;
+
+  std::vector<std::thread> workers_;
+
+  /// Guards job_, generation_, stopping_ and the active count of the job.
+  std::mutex mutex_;
+
+  /// Serializes calls to for_each_chunk().
+  std::mutex submit_mutex_;
+
+  std::condition_variable work_available_;
+  std::condition_variable work_finished_;
+
+  /// The call in progress, or nullptr once its chunks have all been claimed.
+  job* job_;
+
+  /// Incremented for every call, so that a worker joins each call at most once.
+  std::uint64_t generation_;
+
+  bool stopping_;
+};
+
+}
+
+#endif // STATELESS_PARALLEL_EXECUTOR_HPP
@@ -0,0 +1,105 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_PARALLEL_FIRE_HPP
+#define STATELESS_PARALLEL_FIRE_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "fire_result.hpp"
+#include "parallel_executor.hpp"
+#include "state_machine_pool.hpp"
+
+namespace stateless
+{
+
+/**
+ * The outcome of firing a trigger on one chunk of the instances of a pool.
+ */
+struct chunk_report
+{
+  /// The identifier of the first instance of the chunk.
+  std::size_t first;
+
+  /// One past the identifier of the last instance of the chunk.
+  std::size_t last;
+
+  /// The number of instances fired and failed in the chunk, and the last outcome.
+  batch_result result;
+
+  /// The instances of the chunk that did not handle the trigger.
+  std::vector<instance_failure> failures;
+};
+
+/**
+ * Fire a trigger on every instance of a pool, processing chunks of
+ * consecutive instances on the threads of an executor.
+ *
+ * Instances that do not handle the trigger are recorded in the report of
+ * their chunk; the unhandled trigger action of the definition is not called.
+ * Guards, decisions and actions run on the worker threads, so they and the
+ * on_transition callback of the pool must be safe to call concurrently.
+ *
+ * \param executor The executor whose threads fire the chunks.
+ * \param pool The instances to fire.
+ * \param trigger The trigger to fire.
+ * \param chunk_size The number of consecutive instances fired as one unit of work.
+ *
+ * \return One report per chunk, in order of instance identifier.
+ */
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+std::vector<chunk_report> parallel_fire_all_instances(
+  parallel_executor& executor,
+  state_machine_pool<TState, TTrigger, TContainerPolicy>& pool,
+  const TTrigger& trigger,
+  std::size_t chunk_size = parallel_executor::default_chunk_size)
+{
+  const auto count = pool.size();
+  std::vector<chunk_report> reports(chunk_size == 0 ? 0 : (count + chunk_size - 1) / chunk_size);
+  executor.for_each_chunk(count, chunk_size,
+    [&](std::size_t chunk, std::size_t first, std::size_t last)
+    {
+      auto& report = reports[chunk];
+      report.first = first;
+      report.last = last;
+      report.result = pool.fire_instances(first, last, trigger, report.failures);
+    });
+  return reports;
+}
+
+/**
+ * Sum the reports of a parallel bulk fire.
+ *
+ * \return The number of instances fired and failed; the last outcome is that
+ *         of the instance with the highest identifier.
+ */
+inline batch_result summarize(const std::vector<chunk_report>& reports)
+{
+  batch_result total = { 0, 0, fire_result::ignored };
+  for (const auto& report : reports)
+  {
+    total.consumed += report.result.consumed;
+    total.failed += report.result.failed;
+    total.last_result = report.result.last_result;
+  }
+  return total;
+}
+
+}
+
+#endif // STATELESS_PARALLEL_FIRE_HPP
@@ -17,31 +17,56 @@
 #ifndef STATELESS_STATE_CONFIGURATION_HPP
 #define STATELESS_STATE_CONFIGURATION_HPP
 
-#include "detail/no_guard.hpp"
+#include "container_policy.hpp"
+#include "detail/arena.hpp"
 #include "detail/state_representation.hpp"
 #include "detail/transition.hpp"
+#include "error.hpp"
+#include "inplace_function.hpp"
 #include "trigger_with_parameters.hpp"
 
-#include <functional>
+#include <cstddef>
 
 namespace stateless
 {
 
-template<typename TState, typename TTrigger>
-class state_machine;
+// Declared here so that the strand overloads below do not pull threading
+// headers into every user; include strand.hpp to use them.
+class strand;
+
+namespace detail
+{
+
+template<typename TCallable, typename TTransition, typename... TArgs>
+struct posted_entry_action;
+
+template<typename TCallable, typename TTransition>
+struct posted_exit_action;
+
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+class machine_configuration;
+
+template<typename TState, typename TTrigger, std::size_t NStates, std::size_t NTriggers>
+class enum_configuration;
+
+}
 
 /**
  * The configuration for a single state value.
  *
  * \tparam TState The type used to represent the states.
  * \tparam TTrigger The type used to represent the triggers that cause state transitions.
+ * \tparam TContainerPolicy The policy selecting the containers used for lookups.
  */
-template<typename TState, typename TTrigger>
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
 class state_configuration
 {
 public:
   /// Parameterized state representation type.
-  typedef detail::state_representation<TState, TTrigger> TStateRepresentation;
+  typedef detail::state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
 
   /// Parameterized trigger behaviour type.
   typedef typename TStateRepresentation::TTriggerBehaviour TTriggerBehaviour;
@@ -58,11 +83,11 @@ public:
   /// Exit action type.
   typedef typename TStateRepresentation::TExitAction TExitAction;
 
-  /// Signature for guard function.
-  typedef std::function<bool()> TGuard;
+  /// Signature for guard function. An empty guard is always met and is never called.
+  typedef inplace_function<bool()> TGuard;
 
   ///Signature for lookup function.
-  typedef std::function<TStateRepresentation*(const TState&)> TLookup;
+  typedef inplace_function<TStateRepresentation*(const TState&)> TLookup;
 
   /**
    * Accept the specified trigger and transition to the destination state.
@@ -141,7 +166,7 @@ public:
    */
   state_configuration& ignore(const TTrigger& trigger)
   {
-    return ignore_if(trigger, detail::no_guard);
+    return ignore_if(trigger, TGuard());
   }
 
   /**
@@ -159,7 +184,7 @@ public:
       {
         return false;
       };
-    auto behaviour = std::make_shared<detail::trigger_behaviour<TState, TTrigger>>(
+    auto behaviour = arena_->create<detail::trigger_behaviour<TState, TTrigger>>(
       trigger, guard, decision);
     representation_->add_trigger_behaviour(trigger, behaviour);
     return *this;
@@ -179,6 +204,24 @@ public:
     return *this;
   }
 
+  /**
+   * Specify an action that will be posted to a strand when transitioning into
+   * the configured state, rather than executed by the firing thread. The
+   * transition and arguments are copied into the posted task.
+   *
+   * \param target The strand, typically one per state machine, that runs the action.
+   * \param entry_action Action to execute, providing details of the transition.
+   *
+   * \return This configuration object.
+   */
+  template<typename... TArgs, typename TCallable>
+  state_configuration& on_entry(const strand& target, TCallable entry_action)
+  {
+    const detail::posted_entry_action<TCallable, TTransition, TArgs...> posted = {
+      target, entry_action };
+    return on_entry<TArgs...>(posted);
+  }
+
   /**
    * Specify an action that will execute when transitioning into the configured state.
    *
@@ -212,6 +255,47 @@ public:
     return *this;
   }
 
+  /**
+   * Specify an action that will be posted to a strand when transitioning into
+   * the configured state by a particular trigger.
+   *
+   * \param target The strand, typically one per state machine, that runs the action.
+   * \param trigger The trigger by which the state must be entered in order for the action to execute.
+   * \param entry_action Action to execute, providing details of the transition.
+   *
+   * \return This configuration object.
+   */
+  template<typename... TArgs, typename TCallable>
+  state_configuration& on_entry_from(
+    const strand& target, const TTrigger& trigger, TCallable entry_action)
+  {
+    const detail::posted_entry_action<TCallable, TTransition, TArgs...> posted = {
+      target, entry_action };
+    return on_entry_from<TArgs...>(trigger, posted);
+  }
+
+  /**
+   * Specify an action that will be posted to a strand when transitioning into
+   * the configured state by a particular trigger. The arguments of the trigger
+   * are copied into the posted task.
+   *
+   * \param target The strand, typically one per state machine, that runs the action.
+   * \param trigger The trigger by which the state must be entered in order for the action to execute.
+   * \param entry_action Action to execute, providing details of the transition.
+   *
+   * \return This configuration object.
+   */
+  template<typename... TArgs, typename TCallable>
+  state_configuration& on_entry_from(
+    const strand& target,
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TCallable entry_action)
+  {
+    const detail::posted_entry_action<TCallable, TTransition, TArgs...> posted = {
+      target, entry_action };
+    return on_entry_from(trigger, posted);
+  }
+
   /**
    * Specify an action that will execute when transitioning from the configured state.
    *
@@ -226,6 +310,23 @@ public:
     return *this;
   }
 
+  /**
+   * Specify an action that will be posted to a strand when transitioning from
+   * the configured state, rather than executed by the firing thread. The
+   * transition is copied into the posted task.
+   *
+   * \param target The strand, typically one per state machine, that runs the action.
+   * \param exit_action Action to execute, providing details of the transition.
+   *
+   * \return This configuration object.
+   */
+  template<typename TCallable>
+  state_configuration& on_exit(const strand& target, TCallable exit_action)
+  {
+    const detail::posted_exit_action<TCallable, TTransition> posted = { target, exit_action };
+    return on_exit(posted);
+  }
+
   /**
    * Set the superstate that the configured state is a substate of.
    *
@@ -260,7 +361,7 @@ public:
   state_configuration& permit_dynamic(const TTrigger& trigger, TCallable decision)
   {
     return this->template internal_permit_dynamic_if<>(
-      trigger, detail::no_guard, decision);
+      trigger, TGuard(), decision);
   }
 
   /**
@@ -278,7 +379,7 @@ public:
     TCallable decision)
   {
     return this->template internal_permit_dynamic_if<TCallable, TArgs...>(
-      trigger->trigger(), detail::no_guard, decision);
+      trigger->trigger(), TGuard(), decision);
   }
 
   /**
@@ -319,23 +420,27 @@ public:
   }
 
 private:
-  friend state_machine<TState, TTrigger>;
+  friend detail::machine_configuration<TState, TTrigger, TContainerPolicy>;
+
+  template<typename, typename, std::size_t, std::size_t>
+  friend class detail::enum_configuration;
 
   /**
    * Construct a configuration object for a single state.
    * Not for client use; configuration objects are created by the state_machine.
    */
   state_configuration(
-    TStateRepresentation* representation, const TLookup& lookup)
+    TStateRepresentation* representation, const TLookup& lookup, detail::arena& arena)
     : representation_(representation)
     , lookup_(lookup)
+    , arena_(&arena)
   {}
 
   void enforce_not_identity_transition(const TState& destination)
   {
     if (destination == representation_->underlying_state())
     {
-      throw error(
+      raise_error(
         "permit() (and permit_if()) require that the destination state is not "
         "equal to the source state. To accept a trigger without changing state, "
         "use either ignore() or permit_reentry().");
@@ -345,10 +450,7 @@ private:
   state_configuration& internal_permit(
     const TTrigger& trigger, const TState& destination_state)
   {
-    return internal_permit_if(
-      trigger,
-      destination_state,
-      detail::no_guard);
+    return internal_permit_if(trigger, destination_state, TGuard());
   }
 
   state_configuration& internal_permit_if(
@@ -356,6 +458,8 @@ private:
     const TState& destination_state,
     const TGuard& guard)
   {
+    // Register the destination so that it exists when the machine is frozen.
+    lookup_(destination_state);
     auto decision =
       [=](const TState& source, TState& destination)
       -> bool
@@ -363,7 +467,7 @@ private:
         destination = destination_state;
         return true;
       };
-    auto behaviour = std::make_shared<detail::trigger_behaviour<TState, TTrigger>>(
+    auto behaviour = arena_->create<detail::trigger_behaviour<TState, TTrigger>>(
       trigger, guard, decision);
     representation_->add_trigger_behaviour(trigger, behaviour);
     return *this;
@@ -376,7 +480,7 @@ private:
     TCallable decision)
   {
     auto behaviour =
-      std::make_shared<detail::dynamic_trigger_behaviour<TState, TTrigger, TArgs...>>(
+      arena_->create<detail::dynamic_trigger_behaviour<TState, TTrigger, TArgs...>>(
         trigger, guard, decision);
     representation_->add_trigger_behaviour(trigger, behaviour);
     return *this;
@@ -384,6 +488,7 @@ private:
 
   TStateRepresentation* representation_;
   TLookup lookup_;
+  detail::arena* arena_;
 };
 
 }
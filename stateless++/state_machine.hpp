@@ -17,34 +17,51 @@
 #ifndef STATELESS_STATE_MACHINE_HPP
 #define STATELESS_STATE_MACHINE_HPP
 
+#include <atomic>
 #include <functional>
-#include <map>
 #include <memory>
 #include <set>
 #include <sstream>
-#include <deque>
+#include <utility>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
+#include "container_policy.hpp"
+#include "fire_result.hpp"
+#include "inplace_function.hpp"
 #include "print_state.hpp"
 #include "print_trigger.hpp"
 #include "state_configuration.hpp"
+#include "detail/firing.hpp"
+#include "detail/machine_configuration.hpp"
+#include "detail/mpsc_queue.hpp"
+#include "detail/transition_core.hpp"
 #include "trigger_with_parameters.hpp"
 
 namespace stateless
 {
 
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+class state_machine_actor;
+
 /**
  * Models behaviour as transitions between a finite set of states.
  *
  * \tparam TState The type used to represent the states.
  * \tparam TTrigger The type used to represent the triggers that cause state transitions.
+ * \tparam TContainerPolicy The policy selecting the containers used to look up states
+ *                          and triggers; see container_policy.hpp.
  */
-template<typename TState, typename TTrigger>
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
 class state_machine
 {
 public:
   /// Parameterized state configuration type.
-  typedef state_configuration<TState, TTrigger> TStateConfiguration;
+  typedef state_configuration<TState, TTrigger, TContainerPolicy> TStateConfiguration;
 
   /// Parameterized transition type.
   typedef typename TStateConfiguration::TTransition TTransition;
@@ -52,25 +69,33 @@ public:
   /// Parameterized trigger with parameters type.
   typedef typename TStateConfiguration::TTriggerWithParameters TTriggerWithParameters;
 
+  /// Identifier of a trigger that is not configured.
+  static const std::size_t npos = static_cast<std::size_t>(-1);
+
   /// Signature for read access of externally managed state.
-  typedef std::function<const TState()> TStateAccessor;
+  typedef inplace_function<const TState()> TStateAccessor;
 
   /// Signature for write access to externally managed state.
-  typedef std::function<void(const TState&)> TStateMutator;
+  typedef inplace_function<void(const TState&)> TStateMutator;
 
   /// Signature for handler for unhandled trigger. By default this throws an error.
-  typedef std::function<void(const TState&, const TTrigger&)> TUnhandledTriggerAction;
+  typedef inplace_function<void(const TState&, const TTrigger&)> TUnhandledTriggerAction;
 
   /// Signature for handler for state transition. Does nothing by default.
-  typedef std::function<void(const TTransition&)> TTransitionAction;
+  typedef inplace_function<void(const TTransition&)> TTransitionAction;
 
   /**
    * Construct a state machine with external state storage.
    *
+   * The external state may be written by other means than the state mutator,
+   * in which case the state machine resynchronizes with it the next time the
+   * current state is consulted.
+   *
    * \param state_accessor A function that will be called to read the current state value.
    * \param state_mutator  An action that will be called to write new state values.
    */
   state_machine(const TStateAccessor& state_accessor, const TStateMutator& state_mutator)
+    : deferred_triggers_(STATELESS_DEFERRED_TRIGGER_CAPACITY)
   {
     init(state_accessor, state_mutator);
   }
@@ -81,18 +106,16 @@ public:
    * \param initial_state The initial state.
    */
   state_machine(const TState& initial_state)
+    : deferred_triggers_(STATELESS_DEFERRED_TRIGGER_CAPACITY)
   {
-    auto state = std::make_shared<state_reference>(initial_state);
-    using namespace std::placeholders;
-    init(
-      std::bind(&state_reference::get, state),
-      std::bind(&state_reference::set, state, _1));
+    init(TStateAccessor(), TStateMutator());
+    current_.store(configuration_.get_representation(initial_state), std::memory_order_release);
   }
 
   /// The current state.
   const TState state() const
   {
-    return state_accessor_();
+    return current_representation()->underlying_state();
   }
 
   /**
@@ -105,11 +128,40 @@ public:
    */
   TStateConfiguration configure(const TState& state)
   {
-    using namespace std::placeholders;
-    typedef state_machine<TState, TTrigger> TSelf;
-    return TStateConfiguration(
-      get_representation(state),
-      std::bind(&TSelf::get_representation, this, _1));
+    enforce_not_frozen();
+    return configuration_.configure(state);
+  }
+
+  /**
+   * Finish configuration and compile the configured states into a flat
+   * transition table indexed by dense state and trigger identifiers.
+   * Subsequent calls to fire(), can_fire() and is_in_state() are resolved
+   * against the table rather than by searching the configuration.
+   *
+   * Once frozen the configuration is immutable and looking up a state never
+   * creates a representation, so the query methods state(), is_in_state(),
+   * can_fire(), can_fire_many(), permitted_triggers(), for_each_permitted_trigger(),
+   * permitted_trigger_mask(), trigger_id() and print() may be called from any
+   * number of threads concurrently with a single thread firing triggers.
+   * Guards and the state accessor must then be safe to call concurrently.
+   *
+   * \throw error The state machine has already been frozen.
+   *
+   * \note Neither states nor trigger parameters can be configured once frozen.
+   *       Every state the machine enters must have been configured or be the
+   *       destination of permit(); entering any other state raises an error.
+   */
+  void freeze()
+  {
+    enforce_not_frozen();
+    sync_current_representation();
+    configuration_.freeze();
+  }
+
+  /// Determine whether the state machine has been frozen.
+  bool is_frozen() const
+  {
+    return configuration_.is_frozen();
   }
 
   /**
@@ -127,17 +179,124 @@ public:
     internal_fire(trigger);
   }
 
-  void push_deferred_trigger(const TTrigger& trigger)
+  /**
+   * Transition from the current state via the supplied trigger, reporting
+   * failures in the returned value rather than by throwing.
+   *
+   * Unlike fire(), the unhandled trigger action is not called when the
+   * trigger is unhandled. Exceptions thrown by guards and actions propagate.
+   *
+   * \param trigger The trigger to fire.
+   *
+   * \return The outcome of firing the trigger.
+   */
+  fire_result try_fire(const TTrigger& trigger)
+  {
+    return internal_try_fire(trigger);
+  }
+
+  /**
+   * Transition from the current state via the supplied trigger, reporting
+   * failures in the returned value rather than by throwing.
+   *
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \return The outcome of firing the trigger.
+   */
+  template<typename... TArgs, typename... TParams>
+  fire_result try_fire(
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args)
+  {
+    return internal_try_fire<TArgs...>(trigger->trigger(), std::forward<TParams>(args)...);
+  }
+
+  /**
+   * Fire a sequence of triggers in order, each running to completion before
+   * the next. The current state is resynchronized with external storage
+   * before each trigger, as by fire().
+   *
+   * Triggers that are not handled are reported in the result as by
+   * try_fire(); the unhandled trigger action is not called.
+   *
+   * \param first The first trigger to fire.
+   * \param last One past the last trigger to fire.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   */
+  template<typename TInputIterator>
+  batch_result fire_all(
+    TInputIterator first,
+    TInputIterator last,
+    batch_policy policy = batch_policy::stop_on_failure)
+  {
+    return detail::fire_sequence(first, last, policy, [this](const TTrigger& trigger)
+      {
+        return internal_try_fire(trigger);
+      });
+  }
+
+  /**
+   * Fire a contiguous range of triggers in order, such as an array or vector.
+   *
+   * \param triggers The triggers to fire.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   */
+  template<typename TRange>
+  batch_result fire_all(
+    const TRange& triggers,
+    batch_policy policy = batch_policy::stop_on_failure)
+  {
+    return fire_all(std::begin(triggers), std::end(triggers), policy);
+  }
+
+  /**
+   * Queue a trigger to be fired later by the thread that owns the state
+   * machine. May be called from any thread; it never blocks, and only the
+   * first trigger queued allocates the queue.
+   *
+   * \param trigger The trigger to queue.
+   *
+   * \return False if the queue of deferred triggers is full, in which case
+   *         the trigger is dropped. The capacity is set by
+   *         STATELESS_DEFERRED_TRIGGER_CAPACITY.
+   */
+  bool push_deferred_trigger(const TTrigger& trigger)
   {
-    deferred_triggers_.push_back(trigger);
+    return deferred_triggers_.push(trigger);
   }
 
+  /**
+   * Fire the oldest deferred trigger, removing it from the queue once it
+   * has been fired. Must only be called by the thread that owns the state
+   * machine.
+   *
+   * \return False if no trigger was deferred.
+   */
   bool pop_deferred_trigger()
   {
-      if( deferred_triggers_.size() == 0) return false;
-      fire( deferred_triggers_.front());
-      deferred_triggers_.pop_front();
-      return true;
+    return drain_deferred_triggers(1) == 1;
+  }
+
+  /**
+   * Fire deferred triggers in the order they were queued until none is left.
+   * Must only be called by the thread that owns the state machine.
+   *
+   * \param max_triggers The maximum number of triggers to fire.
+   *
+   * \return The number of triggers fired.
+   */
+  std::size_t drain_deferred_triggers(
+    std::size_t max_triggers = static_cast<std::size_t>(-1))
+  {
+    return detail::drain_queue(deferred_triggers_, max_triggers, [this](const TTrigger& trigger)
+      {
+        internal_fire(trigger);
+      });
   }
 
   /**
@@ -147,16 +306,18 @@ public:
    * will be invoked.
    *
    * \param trigger The trigger to fire.
-   * \param args The arguments to pass in the transition.
+   * \param args The arguments to pass in the transition. They are passed by
+   *             reference to the decision and entry actions and are never copied,
+   *             unless they need to be converted to the configured parameter types.
    *
    * \throw error The current state does not allow the trigger to be fired.
    */
-  template<typename... TArgs>
+  template<typename... TArgs, typename... TParams>
   void fire(
     const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
-    TArgs... args)
+    TParams&&... args)
   {
-    internal_fire(trigger->trigger(), args...);
+    internal_fire<TArgs...>(trigger->trigger(), std::forward<TParams>(args)...);
   }
 
   /**
@@ -188,11 +349,28 @@ public:
    *
    * \return True if the current state is equal to, or a substate of, the supplied state.
    */
-  bool is_in_state(const TState& state)
+  bool is_in_state(const TState& state) const
   {
     return current_representation()->is_included_in(state);
   }
 
+  /**
+   * Determine whether the state machine is in the state with the supplied
+   * identifier, as returned by state_id(). The superstates are not searched;
+   * the identifier is tested against a precomputed bitset.
+   *
+   * \param state_id The identifier of the state to test for.
+   *
+   * \return True if the current state is equal to, or a substate of, the identified state.
+   *
+   * \throw error The state machine is not frozen.
+   */
+  bool is_in_state_id(std::size_t state_id) const
+  {
+    enforce_frozen();
+    return configuration_.table().is_included_in(current_representation()->id(), state_id);
+  }
+
   /**
    * Determine whether supplied trigger can be fired in the current state.
    *
@@ -202,7 +380,29 @@ public:
    */
   bool can_fire(const TTrigger& trigger) const
   {
-    return current_representation()->can_handle(trigger);
+    return configuration_.find_handler(current_representation(), trigger) != nullptr;
+  }
+
+  /**
+   * Determine for each of a sequence of triggers whether it can be fired
+   * in the current state.
+   *
+   * \param first The first trigger to test.
+   * \param last One past the last trigger to test.
+   * \param result Output receiving one bool per trigger.
+   *
+   * \return Output iterator one past the last result written.
+   */
+  template<typename TInputIterator, typename TOutputIterator>
+  TOutputIterator can_fire_many(
+    TInputIterator first, TInputIterator last, TOutputIterator result) const
+  {
+    const auto representation = current_representation();
+    for (; first != last; ++first, ++result)
+    {
+      *result = configuration_.find_handler(representation, *first) != nullptr;
+    }
+    return result;
   }
 
   /**
@@ -217,15 +417,8 @@ public:
   std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>
   set_trigger_parameters(const TTrigger& trigger)
   {
-    auto it = trigger_configuration_.find(trigger);
-    if (it != trigger_configuration_.end())
-    {
-      throw error("Cannot reconfigure trigger parameters");
-    }
-    auto configuration =
-      std::make_shared<trigger_with_parameters<TTrigger, TArgs...>>(trigger);
-    trigger_configuration_[trigger] = configuration;
-    return configuration;
+    enforce_not_frozen();
+    return configuration_.template set_trigger_parameters<TArgs...>(trigger);
   }
 
   /**
@@ -236,6 +429,71 @@ public:
     return current_representation()->permitted_triggers();
   }
 
+  /**
+   * Invoke a visitor with each currently permissible trigger value, without
+   * allocating. Each trigger is visited once, the triggers of the current
+   * state first and those of its outermost superstate last.
+   *
+   * \param visitor Callable accepting a const TTrigger&.
+   */
+  template<typename TVisitor>
+  void for_each_permitted_trigger(TVisitor visitor) const
+  {
+    current_representation()->for_each_permitted_trigger(visitor);
+  }
+
+  /**
+   * Fill a bitset, indexed by trigger identifier, with the currently
+   * permissible triggers. The mask is resized to the number of triggers,
+   * so it does not allocate when reused.
+   *
+   * \param mask The bitset to fill.
+   *
+   * \throw error The state machine is not frozen.
+   */
+  void permitted_trigger_mask(std::vector<bool>& mask) const
+  {
+    enforce_frozen();
+    const auto& table = configuration_.table();
+    const auto id = current_representation()->id();
+    if (id == TStateTable::npos)
+    {
+      mask.assign(table.trigger_count(), false);
+      return;
+    }
+    table.permitted_trigger_mask(id, mask);
+  }
+
+  /**
+   * The dense identifier of a state, for use with is_in_state_id().
+   *
+   * \param state The state.
+   *
+   * \return The identifier, or npos if the state is not configured.
+   *
+   * \throw error The state machine is not frozen.
+   */
+  std::size_t state_id(const TState& state) const
+  {
+    enforce_frozen();
+    return configuration_.table().state_id(state);
+  }
+
+  /**
+   * The dense identifier of a trigger, indexing the bits of permitted_trigger_mask().
+   *
+   * \param trigger The trigger.
+   *
+   * \return The identifier, or npos if no state is configured with the trigger.
+   *
+   * \throw error The state machine is not frozen.
+   */
+  std::size_t trigger_id(const TTrigger& trigger) const
+  {
+    enforce_frozen();
+    return configuration_.table().trigger_id(trigger);
+  }
+
   /**
    * A human readable representation of the state machine.
    *
@@ -251,182 +509,214 @@ public:
   /**
    * Stream output operator.
    */
-  friend inline std::ostream& operator<<(
-    std::ostream& os, const stateless::state_machine<TState, TTrigger>& sm)
+  friend inline std::ostream& operator<<(std::ostream& os, const state_machine& sm)
   {
     sm.print(os);
     return os;
   }
 
 private:
-  /**
-   * Wrapper class for internal state storage.
-   */
-  class state_reference
-  {
-  public:
-    state_reference(const TState& initial_state)
-      : state_(initial_state)
-    {}
-
-    const TState& get() const
-    {
-      return state_;
-    }
-
-    void set(const TState& new_state)
-    {
-      state_ = new_state;
-    }
-
-  private:
-    TState state_;
-  };
+  template<typename, typename, typename>
+  friend class state_machine_actor;
 
   /**
    * Perform initialization.
    *
-   * \param state_accessor A function that will be called to read the current state value.
-   * \param state_mutator  An action that will be called to write new state values.
+   * \param state_accessor A function that will be called to read the current state value,
+   *                       or an empty function if the state is stored internally.
+   * \param state_mutator  An action that will be called to write new state values,
+   *                       or an empty function if the state is stored internally.
    */
   void init(
     const TStateAccessor& state_accessor,
     const TStateMutator& state_mutator)
   {
+    current_.store(nullptr, std::memory_order_relaxed);
     state_accessor_ = state_accessor;
     state_mutator_ = state_mutator;
-    on_unhandled_trigger_ = [](const TState& state, const TTrigger& trigger)
-    {
-      throw error(
-        "No valid leaving transitions are permitted for trigger. "
-        "Consider ignoring the trigger.");
-    };
+    on_unhandled_trigger_ = &detail::raise_unhandled_trigger<TState, TTrigger>;
   }
 
   /// Parameterized state representation type.
-  typedef detail::state_representation<TState, TTrigger> TStateRepresentation;
+  typedef detail::state_representation<TState, TTrigger, TContainerPolicy> TStateRepresentation;
 
-  /// The current representation.
-  const TStateRepresentation* current_representation() const
-  {
-    return get_representation(state());
-  }
+  /// Parameterized configuration type, the table of detail::try_fire().
+  typedef detail::machine_configuration<TState, TTrigger, TContainerPolicy> TConfiguration;
 
-  /// Get the representation corresponding to the supplied state.
-  TStateRepresentation* get_representation(const TState& state) const
+  /// Parameterized compiled transition table type.
+  typedef typename TConfiguration::TStateTable TStateTable;
+
+  /// Cursor of detail::try_fire() over the current state of this machine.
+  struct cursor
   {
-    auto it = state_configuration_.find(state);
-    if (it == state_configuration_.end())
+    std::size_t instance_id() const
     {
-      TStateRepresentation representation(state);
-      auto inserted = state_configuration_.insert(
-        std::make_pair(state, representation));
-      return &inserted.first->second;
+      return 0;
     }
-    return &it->second;
-  }
 
-  /// Set the state.
-  void set_state(const TState& new_state)
-  {
-    state_mutator_(new_state);
-  }
+    void set_current(const TStateRepresentation* representation)
+    {
+      machine->set_state(representation);
+    }
 
-  /// Implementation of state transition given a trigger.
-  template<typename... TArgs>
-  void internal_fire(const TTrigger& trigger, TArgs... args)
-  {
-    auto abstract_configuration = trigger_configuration_.find(trigger);
-    if (abstract_configuration != trigger_configuration_.end())
+    void transitioned(const TTransition& transition)
     {
-      typedef trigger_with_parameters<TTrigger, TArgs...> TParameterizedTrigger;
-      auto configuration =
-        std::dynamic_pointer_cast<TParameterizedTrigger>(
-          abstract_configuration->second);
-      if (configuration == nullptr)
+      if (machine->on_transition_)
+      {
+        machine->on_transition_(transition);
+      }
+      if (report != nullptr)
       {
-        throw error("Invalid number or type of parameters.");
+        (*report)(transition);
       }
     }
 
-    auto abstract_handler = current_representation()->try_find_handler(trigger);
-    if (abstract_handler == nullptr)
-    {
-      on_unhandled_trigger_(
-        current_representation()->underlying_state(), trigger);
-      return;
-    }
+    void entered(const TTransition&)
+    {}
 
-    const auto& source = state();
-    TState destination;
-    bool is_transition = false;
+    state_machine* machine;
+
+    /// Action told of the transition caused by this trigger only, or nullptr.
+    const TTransitionAction* report;
+  };
 
-    typedef detail::dynamic_trigger_behaviour<TState, TTrigger, TArgs...> TDynamicTriggerBehaviour;
-    typedef detail::trigger_behaviour<TState, TTrigger> TTriggerBehaviour;
-    if (auto handler = std::dynamic_pointer_cast<TDynamicTriggerBehaviour>(abstract_handler))
+  void enforce_not_frozen() const
+  {
+    if (configuration_.is_frozen())
     {
-      // A dynamic behaviour is configured, so forward the arguments to it.
-      is_transition = handler->results_in_transition_from(source, destination, args...);
+      raise_error("The state machine is frozen and cannot be reconfigured.");
     }
-    else if (auto handler = std::dynamic_pointer_cast<TTriggerBehaviour>(abstract_handler))
+  }
+
+  void enforce_frozen() const
+  {
+    if (!configuration_.is_frozen())
     {
-      // Fall back to configuration time defined transition.
-      is_transition = handler->results_in_transition_from(source, destination);
+      raise_error("The state machine must be frozen to use state or trigger identifiers.");
     }
-    else
+  }
+
+  /**
+   * The current representation, for queries.
+   *
+   * Internally stored state is held by the cursor itself. Externally stored
+   * state is read through the accessor and only looked up when the value no
+   * longer matches the state the cursor refers to. The cursor is left as it
+   * is, so queries running concurrently with firing never write to it.
+   */
+  const TStateRepresentation* current_representation() const
+  {
+    const auto current = current_.load(std::memory_order_acquire);
+    if (state_accessor_)
     {
-      throw error("Unable to find a suitable handler.");
+      const auto state = state_accessor_();
+      if (current == nullptr || !(current->underlying_state() == state))
+      {
+        return configuration_.find_representation(state);
+      }
     }
+    return current;
+  }
 
-    if (is_transition)
+  /**
+   * The current representation, for firing. Like current_representation(),
+   * but the cursor is moved to the externally stored state when it differs.
+   * Only the firing thread may call this.
+   */
+  const TStateRepresentation* sync_current_representation()
+  {
+    auto current = current_.load(std::memory_order_acquire);
+    if (state_accessor_)
     {
-      TTransition transition(source, destination, trigger);
-      current_representation()->exit(transition);
-      set_state(transition.destination());
-      if (on_transition_)
+      const auto state = state_accessor_();
+      if (current == nullptr || !(current->underlying_state() == state))
       {
-        on_transition_(transition);
+        current = configuration_.find_representation(state);
+        current_.store(current, std::memory_order_release);
       }
-      current_representation()->enter(transition, args...);
     }
+    return current;
+  }
+
+  /// Set the state and move the cursor to its representation.
+  void set_state(const TStateRepresentation* representation)
+  {
+    if (state_mutator_)
+    {
+      state_mutator_(representation->underlying_state());
+    }
+    current_.store(representation, std::memory_order_release);
+  }
+
+  /// Implementation of state transition given a trigger, reporting errors by throwing.
+  template<typename... TArgs>
+  void internal_fire(const TTrigger& trigger, const TArgs&... args)
+  {
+    internal_fire_reporting(nullptr, trigger, args...);
+  }
+
+  /**
+   * Implementation of state transition given a trigger, reporting errors by
+   * throwing. The transition the trigger causes, if any, is passed to report
+   * before the entry actions run; transitions caused by triggers fired from
+   * those actions are not.
+   *
+   * \return The outcome, which is unhandled only if the unhandled trigger
+   *         action returned.
+   */
+  template<typename... TArgs>
+  fire_result internal_fire_reporting(
+    const TTransitionAction* report, const TTrigger& trigger, const TArgs&... args)
+  {
+    cursor c = { this, report };
+    const auto representation = sync_current_representation();
+    return detail::raise_fire_error(
+      detail::try_fire(configuration_, c, representation, trigger, args...),
+      representation,
+      trigger,
+      on_unhandled_trigger_);
+  }
+
+  /// Implementation of state transition given a trigger, reporting errors by value.
+  template<typename... TArgs>
+  fire_result internal_try_fire(const TTrigger& trigger, const TArgs&... args)
+  {
+    cursor c = { this, nullptr };
+    return detail::try_fire(configuration_, c, sync_current_representation(), trigger, args...);
   }
 
   /// Implementation for public print and stream operator.
   void print(std::ostream& os) const
   {
-    auto print_permitted_triggers =
-      [&](const std::set<TTrigger>& pts)
-      {
-        bool first = true;
-        for (auto& pt : pts)
-        {
-          if (!first) os << ", ";
-          first = false;
-          print_trigger<TTrigger>(os, pt);
-        }
-      };
     os << "state_machine { state = ";
     print_state<TState>(os, state());
     os << ", permitted triggers = { ";
-    print_permitted_triggers(permitted_triggers());
+    bool first = true;
+    for (auto& pt : permitted_triggers())
+    {
+      if (!first) os << ", ";
+      first = false;
+      print_trigger<TTrigger>(os, pt);
+    }
     os << " } }";
   }
 
-  /**
-   * Mapping from state to representation.
-   * There is exactly one representation per configured state.
-   */
-  mutable std::map<TState, TStateRepresentation> state_configuration_;
+  /// The configured states and the table compiled from them.
+  TConfiguration configuration_;
 
-  /// Mapping of triggers with arguments to the underlying trigger.
-  std::map<TTrigger, TTriggerWithParameters> trigger_configuration_;
+  /// Triggers queued by any thread to be fired by the owning thread.
+  detail::lazy_mpsc_queue<TTrigger> deferred_triggers_;
 
-  std::deque<TTrigger> deferred_triggers_;
+  /**
+   * Cursor to the representation of the current state. It is only written by
+   * the firing thread and may be read by concurrent queries once frozen.
+   */
+  std::atomic<const TStateRepresentation*> current_;
 
-  /// The state accessor.
+  /// The state accessor, empty when the state is stored internally.
   TStateAccessor state_accessor_;
 
-  /// The state mutator.
+  /// The state mutator, empty when the state is stored internally.
   TStateMutator state_mutator_;
 
   /// Function to call on unhandled trigger.
@@ -436,6 +726,9 @@ private:
   TTransitionAction on_transition_;
 };
 
+template<typename TState, typename TTrigger, typename TContainerPolicy>
+const std::size_t state_machine<TState, TTrigger, TContainerPolicy>::npos;
+
 }
 
 #endif // STATELESS_STATE_MACHINE_HPP
@@ -0,0 +1,308 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_STATE_MACHINE_ACTOR_HPP
+#define STATELESS_STATE_MACHINE_ACTOR_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "state_machine.hpp"
+
+namespace stateless
+{
+
+/**
+ * Runs a state_machine on a thread of its own, firing the triggers posted to
+ * its mailbox one at a time, in the order they were posted.
+ *
+ * Any number of threads may post triggers without locking the machine; each
+ * trigger runs to completion, including its entry and exit actions, before the
+ * next one is taken from the mailbox. Once the actor is constructed only its
+ * thread may fire the machine. Queries from other threads are only safe if
+ * the machine was frozen.
+ *
+ * Triggers still in the mailbox when the actor is destroyed are fired before
+ * its thread exits.
+ *
+ * \warning Errors raised by triggers fired through post(), such as unhandled
+ *          triggers, guard conflicts and bad parameters, are passed to the
+ *          handler given to the constructor. Without one they are reported
+ *          through raise_error() on the actor's thread. The default error
+ *          handler then throws, which terminates the program.
+ *
+ * \tparam TState The type used to represent the states.
+ * \tparam TTrigger The type used to represent the triggers that cause state transitions.
+ * \tparam TContainerPolicy The policy selecting the containers used to look up states
+ *                          and triggers; see container_policy.hpp.
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class state_machine_actor
+{
+public:
+  /// Parameterized state machine type.
+  typedef state_machine<TState, TTrigger, TContainerPolicy> TStateMachine;
+
+  /// Parameterized transition type.
+  typedef typename TStateMachine::TTransition TTransition;
+
+  /// The outcome of a trigger fired through request().
+  struct request_result
+  {
+    /// Transitioned or ignored, or unhandled if the unhandled trigger action returned.
+    fire_result result;
+
+    /// The transition the trigger caused, or nullptr unless it transitioned.
+    std::shared_ptr<const TTransition> transition;
+  };
+
+  /**
+   * Signature for handler for errors raised while firing a posted trigger.
+   * Called on the actor's thread. By default the error is passed to
+   * raise_error(), which terminates the program unless an error handler that
+   * exits differently is installed.
+   */
+  typedef std::function<void(std::exception_ptr)> TErrorAction;
+
+  /**
+   * Start the thread of the actor.
+   *
+   * \param sm The configured state machine. It must outlive the actor.
+   * \param on_error Handler for errors raised by triggers fired through post().
+   *                 Without one such errors terminate the program; see the
+   *                 class description.
+   */
+  explicit state_machine_actor(TStateMachine& sm, const TErrorAction& on_error = TErrorAction())
+    : sm_(sm)
+    , on_error_(on_error)
+    , mutex_()
+    , available_()
+    , mailbox_()
+    , stopping_(false)
+    , thread_()
+  {
+    thread_ = std::thread([this]{ run(); });
+  }
+
+  /// Fire the triggers left in the mailbox and join the thread.
+  ~state_machine_actor()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    available_.notify_one();
+    thread_.join();
+  }
+
+  state_machine_actor(const state_machine_actor&) = delete;
+  state_machine_actor& operator=(const state_machine_actor&) = delete;
+
+  /// The wrapped state machine.
+  const TStateMachine& machine() const
+  {
+    return sm_;
+  }
+
+  /**
+   * Queue a trigger to be fired on the actor's thread. Returns without
+   * waiting for the trigger to be fired.
+   *
+   * \param trigger The trigger to fire.
+   */
+  void post(const TTrigger& trigger)
+  {
+    enqueue([trigger](TStateMachine& sm) { sm.fire(trigger); });
+  }
+
+  /**
+   * Queue a trigger with parameters to be fired on the actor's thread.
+   * The arguments are copied into the mailbox.
+   *
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   */
+  template<typename... TArgs, typename... TParams>
+  void post(
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args)
+  {
+    enqueue([trigger, args...](TStateMachine& sm) { sm.fire(trigger, args...); });
+  }
+
+  /**
+   * Queue a trigger to be fired on the actor's thread, returning the
+   * transition it causes. Transitions caused by triggers fired from its
+   * entry actions are not included.
+   *
+   * \param trigger The trigger to fire.
+   *
+   * \return A future for the outcome and transition, or for the error raised by fire().
+   */
+  std::future<request_result> request(const TTrigger& trigger)
+  {
+    return enqueue_request([trigger](TStateMachine& sm, const TTransitionAction& report)
+      {
+        return sm.internal_fire_reporting(&report, trigger);
+      });
+  }
+
+  /**
+   * Queue a trigger with parameters to be fired on the actor's thread,
+   * returning the transition it causes. The arguments are copied into the mailbox.
+   *
+   * \param trigger The trigger to fire.
+   * \param args The arguments to pass in the transition.
+   *
+   * \return A future for the outcome and transition, or for the error raised by fire().
+   */
+  template<typename... TArgs, typename... TParams>
+  std::future<request_result> request(
+    const std::shared_ptr<trigger_with_parameters<TTrigger, TArgs...>>& trigger,
+    TParams&&... args)
+  {
+    return enqueue_request([trigger, args...](TStateMachine& sm, const TTransitionAction& report)
+      {
+        return sm.template internal_fire_reporting<TArgs...>(&report, trigger->trigger(), args...);
+      });
+  }
+
+private:
+  typedef std::function<void(TStateMachine&)> TMessage;
+
+  typedef typename TStateMachine::TTransitionAction TTransitionAction;
+
+  void enqueue(const TMessage& message)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      mailbox_.push_back(message);
+    }
+    available_.notify_one();
+  }
+
+  template<typename TFire>
+  std::future<request_result> enqueue_request(const TFire& fire)
+  {
+    // std::function requires copyable targets, so the promise is shared.
+    const auto result = std::make_shared<std::promise<request_result>>();
+    enqueue([fire, result](TStateMachine& sm)
+      {
+#ifndef STATELESS_NO_EXCEPTIONS
+        try
+        {
+#endif
+          request_result outcome = { fire_result::ignored, nullptr };
+          const TTransitionAction report = [&outcome](const TTransition& transition)
+            {
+              outcome.transition = std::make_shared<const TTransition>(transition);
+            };
+          outcome.result = fire(sm, report);
+          result->set_value(outcome);
+#ifndef STATELESS_NO_EXCEPTIONS
+        }
+        catch (...)
+        {
+          result->set_exception(std::current_exception());
+        }
+#endif
+      });
+    return result->get_future();
+  }
+
+#ifndef STATELESS_NO_EXCEPTIONS
+  /**
+   * Pass the error being handled to raise_error(), for posted triggers when
+   * no error handler was given. Must be called from a catch block.
+   */
+  [[noreturn]] static void raise_posted_error()
+  {
+    try
+    {
+      throw;
+    }
+    catch (const std::exception& e)
+    {
+      raise_error(e.what());
+    }
+    catch (...)
+    {
+      raise_error("A trigger posted to the actor raised an error.");
+    }
+  }
+#endif
+
+  /// Fire the messages in the mailbox until the actor is stopped and the mailbox is empty.
+  void run()
+  {
+    for (;;)
+    {
+      TMessage message;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        available_.wait(lock, [this]{ return stopping_ || !mailbox_.empty(); });
+        if (mailbox_.empty())
+        {
+          return;
+        }
+        message = std::move(mailbox_.front());
+        mailbox_.pop_front();
+      }
+#ifdef STATELESS_NO_EXCEPTIONS
+      message(sm_);
+#else
+      try
+      {
+        message(sm_);
+      }
+      catch (...)
+      {
+        if (!on_error_)
+        {
+          raise_posted_error();
+        }
+        on_error_(std::current_exception());
+      }
+#endif
+    }
+  }
+
+  TStateMachine& sm_;
+  TErrorAction on_error_;
+
+  /// Guards mailbox_ and stopping_.
+  std::mutex mutex_;
+  std::condition_variable available_;
+  std::deque<TMessage> mailbox_;
+  bool stopping_;
+
+  std::thread thread_;
+};
+
+}
+
+#endif // STATELESS_STATE_MACHINE_ACTOR_HPP
@@ -0,0 +1,334 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_STATE_MACHINE_POOL_HPP
+#define STATELESS_STATE_MACHINE_POOL_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "error.hpp"
+#include "fire_result.hpp"
+#include "inplace_function.hpp"
+#include "machine_definition.hpp"
+#include "detail/firing.hpp"
+
+namespace stateless
+{
+
+/**
+ * The current states of many instances of one machine_definition, stored
+ * contiguously so that a trigger can be applied to all or many of them at once.
+ *
+ * Instances are identified by their index in the pool, which is also the
+ * instance_id() of their transitions. Entry and exit actions run only for the
+ * instances that transition, exactly as if each instance were fired on its
+ * own; triggers that are not handled are counted in the result of the bulk
+ * operation and never reach the unhandled trigger action.
+ *
+ * \tparam TState The type used to represent the states.
+ * \tparam TTrigger The type used to represent the triggers that cause state transitions.
+ * \tparam TContainerPolicy The policy selecting the containers used to look up states
+ *                          and triggers; see container_policy.hpp.
+ */
+template<
+  typename TState,
+  typename TTrigger,
+  typename TContainerPolicy = ordered_container_policy>
+class state_machine_pool
+{
+public:
+  /// Parameterized definition type.
+  typedef machine_definition<TState, TTrigger, TContainerPolicy> TDefinition;
+
+  /// Parameterized transition type.
+  typedef typename TDefinition::TTransition TTransition;
+
+  /// Signature for handler for the transition of an instance, given its identifier.
+  typedef inplace_function<void(std::size_t, const TTransition&)> TInstanceTransitionAction;
+
+  /**
+   * Construct a pool of instances that are all in the same state.
+   * No entry actions are invoked.
+   *
+   * \param definition The frozen definition shared by the instances. It must
+   *                   outlive the pool.
+   * \param size The number of instances.
+   * \param initial_state The initial state of every instance.
+   *
+   * \throw error The definition is not frozen, or the state is not configured.
+   */
+  state_machine_pool(
+    const TDefinition& definition, std::size_t size, const TState& initial_state)
+    : definition_(&definition)
+    , instances_(size, definition.create_instance(initial_state))
+  {}
+
+  /// The number of instances.
+  std::size_t size() const
+  {
+    return instances_.size();
+  }
+
+  /**
+   * Append an instance. No entry actions are invoked.
+   *
+   * \param initial_state The initial state of the instance.
+   *
+   * \return The identifier of the new instance.
+   */
+  std::size_t add(const TState& initial_state)
+  {
+    instances_.push_back(definition_->create_instance(initial_state));
+    return instances_.size() - 1;
+  }
+
+  /**
+   * The current state of an instance.
+   *
+   * \throw error The identifier is not that of an instance of the pool.
+   */
+  const TState& state(std::size_t id) const
+  {
+    return instances_[checked_id(id)].state();
+  }
+
+  /**
+   * Determine whether an instance is in the supplied state.
+   *
+   * \return True if its current state is equal to, or a substate of, the supplied state.
+   *
+   * \throw error The identifier is not that of an instance of the pool.
+   */
+  bool is_in_state(std::size_t id, const TState& state) const
+  {
+    return definition_->is_in_state(instances_[checked_id(id)], state);
+  }
+
+  /**
+   * Register a callback that will be invoked after each instance transitions,
+   * once its entry actions have run.
+   *
+   * \param action The action to execute, accepting the identifier of the
+   *               instance and the details of the transition.
+   */
+  void on_transition(const TInstanceTransitionAction& action)
+  {
+    on_transition_ = action;
+  }
+
+  /**
+   * Fire a trigger on every instance in order of identifier. The trigger is
+   * looked up once for the whole pool.
+   *
+   * \param trigger The trigger to fire.
+   * \param policy Whether to stop at the first instance that does not handle the trigger.
+   *
+   * \return The number of instances the trigger was fired on and the number
+   *         that did not handle it, and the last outcome.
+   */
+  batch_result fire_all_instances(
+    const TTrigger& trigger,
+    batch_policy policy = batch_policy::continue_on_failure)
+  {
+    batch_result result = { 0, 0, fire_result::ignored };
+    const auto trigger_id = definition_->trigger_id(trigger);
+    for (std::size_t id = 0; id < instances_.size(); ++id)
+    {
+      if (!fire_one(result, id, trigger_id, trigger, policy))
+      {
+        break;
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Fire one trigger on each of a sequence of instances. The n-th trigger is
+   * fired on the n-th instance; an instance may appear more than once.
+   *
+   * \param first_id The identifier of the first instance.
+   * \param last_id One past the identifier of the last instance.
+   * \param first_trigger The trigger to fire on the first instance.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   *
+   * \throw error An identifier is not that of an instance of the pool. The
+   *              triggers before it have been fired.
+   */
+  template<typename TIdIterator, typename TTriggerIterator>
+  batch_result fire(
+    TIdIterator first_id,
+    TIdIterator last_id,
+    TTriggerIterator first_trigger,
+    batch_policy policy = batch_policy::continue_on_failure)
+  {
+    batch_result result = { 0, 0, fire_result::ignored };
+    if (first_id == last_id)
+    {
+      return result;
+    }
+
+    // Consecutive equal triggers are looked up once.
+    TTrigger trigger = *first_trigger;
+    auto trigger_id = definition_->trigger_id(trigger);
+    for (; first_id != last_id; ++first_id, ++first_trigger)
+    {
+      if (!(*first_trigger == trigger))
+      {
+        trigger = *first_trigger;
+        trigger_id = definition_->trigger_id(trigger);
+      }
+      if (!fire_one(result, checked_id(*first_id), trigger_id, trigger, policy))
+      {
+        break;
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Fire one trigger on each of a sequence of instances, given as ranges
+   * such as arrays or vectors.
+   *
+   * \param ids The identifiers of the instances.
+   * \param triggers The triggers to fire, one for each identifier.
+   * \param policy Whether to stop at the first trigger that is not handled.
+   *
+   * \return The number of triggers consumed and failed, and the last outcome.
+   *
+   * \throw error The ranges differ in length, or an identifier is not that
+   *              of an instance of the pool.
+   */
+  template<typename TIds, typename TTriggers>
+  batch_result fire(
+    const TIds& ids,
+    const TTriggers& triggers,
+    batch_policy policy = batch_policy::continue_on_failure)
+  {
+    if (std::distance(std::begin(ids), std::end(ids))
+      != std::distance(std::begin(triggers), std::end(triggers)))
+    {
+      raise_error("The number of instance identifiers and triggers must be equal.");
+    }
+    return fire(std::begin(ids), std::end(ids), std::begin(triggers), policy);
+  }
+
+  /**
+   * Fire a trigger on the instances with identifiers from first to last,
+   * recording each instance that does not handle it and carrying on.
+   *
+   * Disjoint ranges may be fired from different threads at once, provided
+   * guards and actions, including the on_transition callback, are safe to call
+   * concurrently; see parallel_fire.hpp.
+   *
+   * \param first The identifier of the first instance.
+   * \param last One past the identifier of the last instance.
+   * \param trigger The trigger to fire.
+   * \param failures Output to which the instances that do not handle the
+   *                 trigger are appended.
+   *
+   * \return The number of instances the trigger was fired on and the number
+   *         that did not handle it, and the last outcome.
+   *
+   * \throw error The range is not within the pool.
+   */
+  batch_result fire_instances(
+    std::size_t first,
+    std::size_t last,
+    const TTrigger& trigger,
+    std::vector<instance_failure>& failures)
+  {
+    if (first > last || last > instances_.size())
+    {
+      raise_error("The instance identifiers are outside the pool.");
+    }
+    batch_result result = { 0, 0, fire_result::ignored };
+    const auto trigger_id = definition_->trigger_id(trigger);
+    for (auto id = first; id < last; ++id)
+    {
+      fire_one(result, id, trigger_id, trigger, batch_policy::continue_on_failure);
+      if (!is_handled(result.last_result))
+      {
+        const instance_failure failure = { id, result.last_result };
+        failures.push_back(failure);
+      }
+    }
+    return result;
+  }
+
+private:
+  typedef typename TDefinition::TInstance TInstance;
+
+  /// Reports a transition to on_transition() once its entry actions have run.
+  struct transition_reporter
+  {
+    void operator()(const TTransition& transition) const
+    {
+      if (pool->on_transition_)
+      {
+        pool->on_transition_(transition.instance_id(), transition);
+      }
+    }
+
+    const state_machine_pool* pool;
+  };
+
+  /// Check that an identifier is that of an instance of the pool.
+  std::size_t checked_id(std::size_t id) const
+  {
+    if (id >= instances_.size())
+    {
+      raise_error("The instance identifier is outside the pool.");
+    }
+    return id;
+  }
+
+  /**
+   * Fire a trigger on one instance and account for the outcome.
+   *
+   * \return False if the batch should stop.
+   */
+  bool fire_one(
+    batch_result& result,
+    std::size_t id,
+    std::size_t trigger_id,
+    const TTrigger& trigger,
+    batch_policy policy)
+  {
+    transition_reporter reporter = { this };
+    return detail::record_batch_outcome(
+      result,
+      definition_->internal_try_fire_id(instances_[id], id, trigger_id, trigger, reporter),
+      policy);
+  }
+
+  /// The definition shared by the instances.
+  const TDefinition* definition_;
+
+  /// The instances, indexed by identifier.
+  std::vector<TInstance> instances_;
+
+  /// Function to call after an instance transitions.
+  TInstanceTransitionAction on_transition_;
+};
+
+}
+
+#endif // STATELESS_STATE_MACHINE_POOL_HPP
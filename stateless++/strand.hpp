@@ -0,0 +1,199 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATELESS_STRAND_HPP
+#define STATELESS_STRAND_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "error.hpp"
+
+namespace stateless
+{
+
+/**
+ * Runs posted tasks one at a time, in the order they were posted, on a
+ * user-supplied executor.
+ *
+ * Actions configured with a strand, such as on_entry(strand, action), are
+ * posted to it instead of running inside fire(), so the firing thread gets
+ * control back immediately. Using one strand per state machine keeps the
+ * actions of that machine in order even when the executor runs tasks on
+ * several threads.
+ *
+ * A strand is a handle: copies refer to the same queue, which lives until
+ * the last copy and the last task scheduled on the executor are gone.
+ */
+class strand
+{
+public:
+  /// A task posted to the strand.
+  typedef std::function<void()> TTask;
+
+  /// Signature of the executor, which must eventually run the task it is given.
+  typedef std::function<void(const TTask&)> TExecutor;
+
+  /**
+   * \param executor The executor on which the tasks are run. It may run
+   *                 them on any thread, or immediately.
+   */
+  explicit strand(const TExecutor& executor)
+    : impl_(std::make_shared<impl>(executor))
+  {}
+
+  /**
+   * Queue a task to run after every task posted before it. The executor is
+   * only given a task when the strand is idle, so at most one task of the
+   * strand runs at a time.
+   *
+   * \param task The task to run.
+   */
+  void post(const TTask& task) const
+  {
+    bool schedule = false;
+    {
+      std::lock_guard<std::mutex> lock(impl_->mutex);
+      impl_->tasks.push_back(task);
+      if (!impl_->running)
+      {
+        impl_->running = true;
+        schedule = true;
+      }
+    }
+    if (schedule)
+    {
+      schedule_drain(impl_);
+    }
+  }
+
+  /// Determine whether every posted task has run.
+  bool is_idle() const
+  {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return !impl_->running;
+  }
+
+  /// Block until every posted task has run. Must not be called from a task.
+  void wait() const
+  {
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    impl_->idle.wait(lock, [&]{ return !impl_->running; });
+  }
+
+private:
+  struct impl
+  {
+    explicit impl(const TExecutor& executor)
+      : executor(executor)
+      , mutex()
+      , idle()
+      , tasks()
+      , running(false)
+    {}
+
+    TExecutor executor;
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::deque<TTask> tasks;
+
+    /// Whether a drain is scheduled on the executor or running.
+    bool running;
+  };
+
+  static void schedule_drain(const std::shared_ptr<impl>& s)
+  {
+    s->executor([s]{ drain(s); });
+  }
+
+  /// Run queued tasks until the queue is empty.
+  static void drain(const std::shared_ptr<impl>& s)
+  {
+    for (;;)
+    {
+      TTask task;
+      {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (s->tasks.empty())
+        {
+          s->running = false;
+          s->idle.notify_all();
+          return;
+        }
+        task = std::move(s->tasks.front());
+        s->tasks.pop_front();
+      }
+#ifdef STATELESS_NO_EXCEPTIONS
+      task();
+#else
+      try
+      {
+        task();
+      }
+      catch (...)
+      {
+        // Let the executor see the exception, but keep the remaining tasks running.
+        schedule_drain(s);
+        throw;
+      }
+#endif
+    }
+  }
+
+  std::shared_ptr<impl> impl_;
+};
+
+namespace detail
+{
+
+/// Entry action that posts a copy of the transition and arguments to a strand.
+template<typename TCallable, typename TTransition, typename... TArgs>
+struct posted_entry_action
+{
+  void operator()(const TTransition& transition, const TArgs&... args) const
+  {
+    const auto action = this->action;
+    target.post([action, transition, args...] { action(transition, args...); });
+  }
+
+  strand target;
+  TCallable action;
+};
+
+/// Exit action that posts a copy of the transition to a strand.
+template<typename TCallable, typename TTransition>
+struct posted_exit_action
+{
+  void operator()(const TTransition& transition) const
+  {
+    const auto action = this->action;
+    target.post([action, transition] { action(transition); });
+  }
+
+  strand target;
+  TCallable action;
+};
+
+}
+
+}
+
+#endif // STATELESS_STRAND_HPP
@@ -17,6 +17,8 @@
 #ifndef STATELESS_TRIGGER_WITH_PARAMETERS_HPP
 #define STATELESS_TRIGGER_WITH_PARAMETERS_HPP
 
+#include "detail/signature.hpp"
+
 namespace stateless
 {
 
@@ -24,8 +26,10 @@ template<typename TTrigger>
 class abstract_trigger_with_parameters
 {
 public:
-  abstract_trigger_with_parameters(const TTrigger& underlying_trigger)
+  abstract_trigger_with_parameters(
+    const TTrigger& underlying_trigger, detail::signature_id signature)
     : underlying_trigger_(underlying_trigger)
+    , signature_(signature)
   {}
   
   virtual ~abstract_trigger_with_parameters() = 0;
@@ -35,8 +39,15 @@ public:
     return underlying_trigger_;
   }
 
+  /// Identifies the argument types that must be supplied with the trigger.
+  detail::signature_id signature() const
+  {
+    return signature_;
+  }
+
 private:
   const TTrigger underlying_trigger_;
+  const detail::signature_id signature_;
 };
 
 template<typename TTrigger>
@@ -52,7 +63,8 @@ public:
    * Not for client use; use state_machine::set_trigger_parameters.
    */
   trigger_with_parameters(const TTrigger& underlying_trigger)
-    : abstract_trigger_with_parameters<TTrigger>(underlying_trigger)
+    : abstract_trigger_with_parameters<TTrigger>(
+        underlying_trigger, detail::signature<TArgs...>::id())
   {}
 };
 
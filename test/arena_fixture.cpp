@@ -0,0 +1,83 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/detail/arena.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+using namespace stateless::detail;
+using namespace testing;
+
+namespace
+{
+
+struct recorder
+{
+  recorder(std::vector<int>& destroyed, int id)
+    : destroyed_(destroyed), id_(id)
+  {}
+
+  ~recorder()
+  {
+    destroyed_.push_back(id_);
+  }
+
+  std::vector<int>& destroyed_;
+  int id_;
+};
+
+TEST(Arena, WhenDestroyed_ThenObjectsAreDestroyedInReverseOrder)
+{
+  std::vector<int> destroyed;
+  {
+    arena a;
+    a.create<recorder>(destroyed, 0);
+    a.create<recorder>(destroyed, 1);
+    ASSERT_TRUE(destroyed.empty());
+  }
+
+  ASSERT_EQ(2, destroyed.size());
+  EXPECT_EQ(1, destroyed.at(0));
+  EXPECT_EQ(0, destroyed.at(1));
+}
+
+TEST(Arena, WhenObjectsAreCreated_ThenTheyAreAligned)
+{
+  arena a;
+  a.create<char>('x');
+  auto d = a.create<double>(1.5);
+
+  EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(d) % alignof(double));
+  EXPECT_EQ(1.5, *d);
+}
+
+TEST(Arena, WhenObjectIsLargerThanABlock_ThenItIsCreated)
+{
+  struct large { char bytes[10000]; };
+  arena a;
+  auto c = a.create<char>('x');
+  auto l = a.create<large>();
+  l->bytes[9999] = 'y';
+
+  EXPECT_EQ('x', *c);
+  EXPECT_EQ('y', l->bytes[9999]);
+}
+
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/state_machine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+template<typename TContainerPolicy>
+class ContainerPolicy : public Test
+{
+protected:
+  typedef state_machine<std::string, std::string, TContainerPolicy> TStateMachine;
+
+  /// Configure a ring of states, each a substate of a common superstate.
+  void configure_ring(TStateMachine& sm, int count)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      sm.configure(name(i))
+        .sub_state_of("ring")
+        .permit("next", name((i + 1) % count));
+    }
+    sm.configure("ring").permit("leave", "outside");
+  }
+
+  static std::string name(int i)
+  {
+    return "state " + std::to_string(i);
+  }
+};
+
+typedef Types<
+  ordered_container_policy,
+  unordered_container_policy,
+  flat_container_policy> Policies;
+
+TYPED_TEST_CASE(ContainerPolicy, Policies);
+
+TYPED_TEST(ContainerPolicy, WhenFireTrigger_ThenTransitionsToConfiguredDestinationState)
+{
+  typename TestFixture::TStateMachine sm(TestFixture::name(0));
+  this->configure_ring(sm, 100);
+
+  for (int i = 1; i <= 150; ++i)
+  {
+    sm.fire("next");
+    ASSERT_EQ(TestFixture::name(i % 100), sm.state());
+  }
+  ASSERT_TRUE(sm.is_in_state("ring"));
+
+  sm.fire("leave");
+
+  ASSERT_EQ("outside", sm.state());
+  ASSERT_FALSE(sm.can_fire("next"));
+}
+
+TYPED_TEST(ContainerPolicy, WhenFrozen_ThenTransitionsToConfiguredDestinationState)
+{
+  typename TestFixture::TStateMachine sm(TestFixture::name(0));
+  this->configure_ring(sm, 100);
+  sm.freeze();
+
+  for (int i = 1; i <= 150; ++i)
+  {
+    sm.fire("next");
+    ASSERT_EQ(TestFixture::name(i % 100), sm.state());
+  }
+  ASSERT_TRUE(sm.is_in_state("ring"));
+  ASSERT_TRUE(sm.can_fire("leave"));
+}
+
+TYPED_TEST(ContainerPolicy, WhenParametersSuppliedToFire_ThenTheyArePassedToEntryAction)
+{
+  typename TestFixture::TStateMachine sm("A");
+  auto x = sm.template set_trigger_parameters<int>("X");
+  int assigned_int = 0;
+  sm.configure("A").permit("X", "B");
+  sm.configure("B").on_entry_from(
+    x, [&](const typename TestFixture::TStateMachine::TTransition&, int i){ assigned_int = i; });
+
+  sm.fire(x, 42);
+
+  ASSERT_EQ(42, assigned_int);
+}
+
+TEST(FlatMap, WhenInsertedOutOfOrder_ThenEntriesAreSorted)
+{
+  detail::flat_map<int, char> m;
+  m.insert(std::make_pair(3, 'c'));
+  m.insert(std::make_pair(1, 'a'));
+  m[2] = 'b';
+
+  ASSERT_FALSE(m.insert(std::make_pair(1, 'z')).second);
+  ASSERT_EQ(3, m.size());
+  auto it = m.begin();
+  EXPECT_EQ('a', (it++)->second);
+  EXPECT_EQ('b', (it++)->second);
+  EXPECT_EQ('c', (it++)->second);
+  EXPECT_EQ(m.end(), m.find(4));
+  EXPECT_EQ('b', m.find(2)->second);
+}
+
+}
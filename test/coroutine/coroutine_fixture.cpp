@@ -0,0 +1,257 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/coroutine.hpp>
+#include <stateless++/enum_state_machine.hpp>
+#include <stateless++/state_machine.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+
+namespace
+{
+
+using TStateMachine = state_machine<state, trigger>;
+using TEnumStateMachine = enum_state_machine<state, trigger, 3, 3>;
+using TAsyncStateMachine = async_state_machine<TStateMachine>;
+
+/// Coroutine that starts eagerly and is not awaited by anyone.
+struct detached
+{
+  struct promise_type
+  {
+    detached get_return_object() { return detached(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+/// Executor that queues tasks until the test runs them.
+struct manual_executor
+{
+  void run_all()
+  {
+    while (!tasks.empty())
+    {
+      auto task = tasks.front();
+      tasks.erase(tasks.begin());
+      task();
+    }
+  }
+
+  std::vector<strand::TTask> tasks;
+};
+
+/// Executor that runs each task immediately on the posting thread.
+void run_inline(const strand::TTask& task)
+{
+  task();
+}
+
+template<typename TAsync, typename TTriggerArg, typename... TArgs>
+detached fire_then_log(
+  TAsync& sm, std::vector<std::string>& order, TTriggerArg trigger, TArgs... args)
+{
+  co_await sm.fire_async(trigger, args...);
+  order.push_back("resumed");
+}
+
+template<typename TAsync>
+detached wait_then_log(TAsync& sm, std::vector<std::string>& order, state s)
+{
+  co_await sm.until_in_state(s);
+  order.push_back("resumed");
+}
+
+detached fire_catching(TAsyncStateMachine& sm, std::string& error)
+{
+  try
+  {
+    co_await sm.fire_async(trigger::Y);
+  }
+  catch (const std::exception& e)
+  {
+    error = e.what();
+  }
+}
+
+TEST(AsyncStateMachine, WhenFireAsyncAwaited_ThenResumedAfterPostedEntryActions)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TStateMachine sm(state::A);
+  std::vector<std::string> order;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B)
+    .on_entry(actions, [&](const TStateMachine::TTransition&) { order.push_back("enter B"); });
+  TAsyncStateMachine async_sm(sm, actions);
+
+  fire_then_log(async_sm, order, trigger::X);
+
+  ASSERT_EQ(state::B, sm.state());
+  ASSERT_TRUE(order.empty());
+  executor.run_all();
+  ASSERT_EQ(std::vector<std::string>({ "enter B", "resumed" }), order);
+}
+
+TEST(AsyncStateMachine, WhenParameterisedTriggerFiredAsync_ThenArgumentsArePassed)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<std::string>(trigger::X);
+  std::vector<std::string> order;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B)
+    .on_entry_from(actions, x, [&](const TStateMachine::TTransition&, const std::string& s)
+      {
+        order.push_back(s);
+      });
+  TAsyncStateMachine async_sm(sm, actions);
+
+  fire_then_log(async_sm, order, x, std::string("argument"));
+  executor.run_all();
+
+  ASSERT_EQ(std::vector<std::string>({ "argument", "resumed" }), order);
+}
+
+TEST(AsyncStateMachine, WhenFireAsyncRaises_ThenErrorIsThrownFromCoAwait)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  TAsyncStateMachine async_sm(sm, actions);
+  std::string error;
+
+  fire_catching(async_sm, error);
+
+  ASSERT_FALSE(error.empty());
+  ASSERT_TRUE(executor.tasks.empty());
+}
+
+TEST(AsyncStateMachine, WhenAlreadyInState_ThenUntilInStateCompletesImmediately)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TStateMachine sm(state::A);
+  TAsyncStateMachine async_sm(sm, actions);
+  std::vector<std::string> order;
+
+  wait_then_log(async_sm, order, state::A);
+
+  ASSERT_EQ(std::vector<std::string>({ "resumed" }), order);
+}
+
+TEST(AsyncStateMachine, WhenSubstateEntered_ThenUntilInStateResumesWaiter)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TStateMachine sm(state::A);
+  std::vector<std::string> order;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::Y, state::C);
+  sm.configure(state::C).sub_state_of(state::A);
+  TAsyncStateMachine async_sm(sm, actions);
+
+  sm.fire(trigger::X);
+  wait_then_log(async_sm, order, state::A);
+  sm.fire(trigger::Y);
+
+  ASSERT_TRUE(order.empty());
+  executor.run_all();
+  ASSERT_EQ(std::vector<std::string>({ "resumed" }), order);
+}
+
+TEST(AsyncStateMachine, WhenOtherStateEntered_ThenWaiterIsNotResumed)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TStateMachine sm(state::A);
+  std::vector<std::string> order;
+  std::vector<state> transitions;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::Y, state::A);
+  TAsyncStateMachine async_sm(sm, actions);
+  async_sm.on_transition([&](const TStateMachine::TTransition& t)
+    {
+      transitions.push_back(t.destination());
+    });
+
+  wait_then_log(async_sm, order, state::C);
+  sm.fire(trigger::X);
+  sm.fire(trigger::Y);
+  executor.run_all();
+
+  ASSERT_TRUE(order.empty());
+  ASSERT_EQ(std::vector<state>({ state::B, state::A }), transitions);
+}
+
+detached wait_twice_then_log(TAsyncStateMachine& sm, std::vector<std::string>& order)
+{
+  co_await sm.until_in_state(state::B);
+  order.push_back("B");
+  co_await sm.until_in_state(state::C);
+  order.push_back("C");
+}
+
+TEST(AsyncStateMachine, WhenExecutorRunsTasksInline_ThenResumedWaiterCanWaitAgain)
+{
+  strand actions(&run_inline);
+  TStateMachine sm(state::A);
+  std::vector<std::string> order;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::Y, state::C);
+  TAsyncStateMachine async_sm(sm, actions);
+
+  wait_twice_then_log(async_sm, order);
+  sm.fire(trigger::X);
+  ASSERT_EQ(std::vector<std::string>({ "B" }), order);
+  sm.fire(trigger::Y);
+
+  ASSERT_EQ(std::vector<std::string>({ "B", "C" }), order);
+}
+
+TEST(AsyncStateMachine, WhenEnumStateMachineDriven_ThenFireAsyncAndUntilInStateResume)
+{
+  manual_executor executor;
+  strand actions([&](const strand::TTask& task) { executor.tasks.push_back(task); });
+  TEnumStateMachine sm(state::A);
+  std::vector<std::string> order;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B);
+  async_state_machine<TEnumStateMachine> async_sm(sm, actions);
+
+  wait_then_log(async_sm, order, state::B);
+  fire_then_log(async_sm, order, trigger::X);
+  executor.run_all();
+
+  ASSERT_EQ(std::vector<std::string>({ "resumed", "resumed" }), order);
+}
+
+}
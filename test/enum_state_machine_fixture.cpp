@@ -0,0 +1,211 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stateless++/enum_state_machine.hpp>
+
+#include <bitset>
+#include <iterator>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef enum_state_machine<state, trigger, 3, 3> TStateMachine;
+#else
+using TStateMachine = enum_state_machine<state, trigger, 3, 3>;
+#endif
+
+TEST(EnumStateMachine, WhenConstructed_ThenInitialStateIsCurrent)
+{
+  TStateMachine sm(state::B);
+  ASSERT_EQ(state::B, sm.state());
+}
+
+TEST(EnumStateMachine, WhenFireTrigger_ThenTransitionsToConfiguredDestinationState)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+
+  sm.fire(trigger::X);
+
+  ASSERT_EQ(state::B, sm.state());
+}
+
+TEST(EnumStateMachine, WhenInSubstate_ThenSuperstateTransitionsApply)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B).sub_state_of(state::C);
+  sm.configure(state::C).permit(trigger::Y, state::A);
+
+  ASSERT_TRUE(sm.is_in_state(state::C));
+  ASSERT_TRUE(sm.can_fire(trigger::Y));
+  ASSERT_FALSE(sm.can_fire(trigger::X));
+
+  sm.fire(trigger::Y);
+
+  ASSERT_EQ(state::A, sm.state());
+}
+
+TEST(EnumStateMachine, WhenConfiguredAfterFiring_ThenNewTransitionsApply)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.fire(trigger::X);
+
+  sm.configure(state::B).permit(trigger::Z, state::C);
+  sm.fire(trigger::Z);
+
+  ASSERT_EQ(state::C, sm.state());
+}
+
+TEST(EnumStateMachine, WhenDiscriminatedByGuard_ThenChoosesPermittedTransition)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B)
+    .permit_if(trigger::X, state::A, [](){ return false; })
+    .permit_if(trigger::X, state::C, [](){ return true; });
+  sm.fire(trigger::X);
+
+  ASSERT_EQ(state::C, sm.state());
+}
+
+TEST(EnumStateMachine, WhenParametersSuppliedToFire_ThenTheyArePassedToEntryAction)
+{
+  TStateMachine sm(state::B);
+  auto x = sm.set_trigger_parameters<std::string, int>(trigger::X);
+  sm.configure(state::B).permit(trigger::X, state::C);
+
+  std::string assigned_string;
+  int assigned_int = 0;
+  sm.configure(state::C)
+    .on_entry_from(
+      x,
+      [&](const TStateMachine::TTransition&, const std::string& s, int i)
+      {
+        assigned_string = s;
+        assigned_int = i;
+      });
+
+  sm.fire(x, "something", 42);
+
+  ASSERT_EQ("something", assigned_string);
+  ASSERT_EQ(42, assigned_int);
+  ASSERT_THROW(sm.set_trigger_parameters<int>(trigger::X), stateless::error);
+}
+
+TEST(EnumStateMachine, WhenUnhandledTriggerIsFired_ThenTheProvidedHandlerIsCalledWithStateAndTrigger)
+{
+  TStateMachine sm(state::B);
+
+  state unhandled_state = state::A;
+  trigger unhandled_trigger = trigger::X;
+  sm.on_unhandled_trigger(
+    [&](const state& s, const trigger& t)
+    {
+      unhandled_state = s;
+      unhandled_trigger = t;
+    });
+
+  sm.fire(trigger::Z);
+
+  ASSERT_EQ(state::B, unhandled_state);
+  ASSERT_EQ(trigger::Z, unhandled_trigger);
+}
+
+TEST(EnumStateMachine, WhenStateIsOutOfRange_ThenConfigurationRaisesError)
+{
+  TStateMachine sm(state::A);
+
+  ASSERT_THROW(sm.configure(static_cast<state>(3)), stateless::error);
+}
+
+TEST(EnumStateMachine, WhenInSubstate_ThenPermittedTriggerMaskIncludesSuperstateTriggers)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B).sub_state_of(state::C).permit_if(trigger::X, state::A, [](){ return false; });
+  sm.configure(state::C).permit(trigger::X, state::A).permit(trigger::Y, state::A);
+
+  std::bitset<3> mask;
+  sm.permitted_trigger_mask(mask);
+
+  EXPECT_TRUE(mask[static_cast<std::size_t>(trigger::X)]);
+  EXPECT_TRUE(mask[static_cast<std::size_t>(trigger::Y)]);
+  EXPECT_FALSE(mask[static_cast<std::size_t>(trigger::Z)]);
+}
+
+TEST(EnumStateMachine, WhenCanFireMany_ThenResultPerTriggerIsWritten)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::Y, state::B);
+
+  const trigger triggers[] = { trigger::X, trigger::Y, trigger::Z };
+  bool result[3] = { true, false, true };
+  auto end = sm.can_fire_many(std::begin(triggers), std::end(triggers), result);
+
+  ASSERT_EQ(result + 3, end);
+  EXPECT_FALSE(result[0]);
+  EXPECT_TRUE(result[1]);
+  EXPECT_FALSE(result[2]);
+}
+
+TEST(EnumStateMachine, WhenTryFire_ThenOutcomeIsReturned)
+{
+  TStateMachine sm(state::A);
+  auto y = sm.set_trigger_parameters<int>(trigger::Y);
+  sm.configure(state::A)
+    .permit(trigger::X, state::B)
+    .ignore(trigger::Y);
+  sm.configure(state::B)
+    .permit_if(trigger::X, state::A, [](){ return true; })
+    .permit_if(trigger::X, state::C, [](){ return true; });
+
+  EXPECT_EQ(fire_result::bad_parameters, sm.try_fire(trigger::Y));
+  EXPECT_EQ(fire_result::ignored, sm.try_fire(y, 1));
+  EXPECT_EQ(fire_result::unhandled, sm.try_fire(trigger::Z));
+  EXPECT_EQ(fire_result::transitioned, sm.try_fire(trigger::X));
+  EXPECT_EQ(fire_result::guard_conflict, sm.try_fire(trigger::X));
+  EXPECT_EQ(state::B, sm.state());
+}
+
+TEST(EnumStateMachine, WhenFireAll_ThenConsumedTriggersAreReported)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::Y, state::C);
+
+  const trigger triggers[] = { trigger::X, trigger::X, trigger::Y };
+
+  auto stopped = sm.fire_all(triggers);
+  EXPECT_EQ(2, stopped.consumed);
+  EXPECT_EQ(fire_result::unhandled, stopped.last_result);
+  EXPECT_EQ(state::B, sm.state());
+
+  auto continued = sm.fire_all(
+    std::begin(triggers) + 1, std::end(triggers), batch_policy::continue_on_failure);
+  EXPECT_EQ(2, continued.consumed);
+  EXPECT_EQ(1, continued.failed);
+  EXPECT_EQ(state::C, sm.state());
+}
+
+}
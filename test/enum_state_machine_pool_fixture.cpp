@@ -0,0 +1,347 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/enum_state_machine_pool.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef enum_state_machine_pool<state, trigger, 3, 3> TPool;
+#else
+using TPool = enum_state_machine_pool<state, trigger, 3, 3>;
+#endif
+
+void configure(TPool& pool, int& entries, int& exits)
+{
+  pool.configure(state::A)
+    .permit(trigger::X, state::B)
+    .on_exit([&](const TPool::TTransition&) { ++exits; });
+  pool.configure(state::B)
+    .ignore(trigger::X)
+    .permit(trigger::Y, state::A)
+    .on_entry([&](const TPool::TTransition&) { ++entries; });
+  pool.configure(state::C)
+    .permit_reentry(trigger::Y);
+}
+
+TEST(EnumStateMachinePool, WhenFewerThan256States_ThenStatesAreStoredInBytes)
+{
+  ASSERT_TRUE((std::is_same<std::uint8_t, TPool::TStateStorage>::value));
+  ASSERT_TRUE((std::is_same<
+    std::uint16_t, enum_state_machine_pool<state, trigger, 257, 3>::TStateStorage>::value));
+}
+
+TEST(EnumStateMachinePool, WhenNotFrozen_ThenFireAllInstancesRaisesError)
+{
+  TPool pool(2, state::A);
+  pool.configure(state::A).permit(trigger::X, state::B);
+
+  ASSERT_THROW(pool.fire_all_instances(trigger::X), stateless::error);
+}
+
+TEST(EnumStateMachinePool, WhenFireAllInstances_ThenOnlyChangingInstancesRunActions)
+{
+  TPool pool(3, state::A);
+  int entries = 0, exits = 0;
+  configure(pool, entries, exits);
+  pool.freeze();
+  pool.add(state::B);
+  pool.add(state::C);
+
+  std::vector<std::size_t> transitioned;
+  pool.on_transition([&](std::size_t id, const TPool::TTransition&) { transitioned.push_back(id); });
+  auto result = pool.fire_all_instances(trigger::X);
+
+  ASSERT_EQ(5U, result.consumed);
+  ASSERT_EQ(1U, result.failed);
+  ASSERT_EQ(fire_result::unhandled, result.last_result);
+  ASSERT_EQ(3, exits);
+  ASSERT_EQ(3, entries);
+  ASSERT_EQ(std::vector<std::size_t>({ 0, 1, 2 }), transitioned);
+  ASSERT_EQ(state::B, pool.state(3));
+  ASSERT_EQ(state::C, pool.state(4));
+}
+
+TEST(EnumStateMachinePool, WhenLastInstanceIgnoresTrigger_ThenLastResultIsIgnored)
+{
+  TPool pool(1, state::A);
+  int entries = 0, exits = 0;
+  configure(pool, entries, exits);
+  pool.freeze();
+  pool.add(state::B);
+
+  auto result = pool.fire_all_instances(trigger::X);
+
+  ASSERT_EQ(2U, result.consumed);
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(fire_result::ignored, result.last_result);
+}
+
+TEST(EnumStateMachinePool, WhenEmpty_ThenFireAllInstancesConsumesNothing)
+{
+  TPool pool(0, state::A);
+  int entries = 0, exits = 0;
+  configure(pool, entries, exits);
+  pool.freeze();
+
+  auto result = pool.fire_all_instances(trigger::X);
+  ASSERT_EQ(0U, result.consumed);
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(fire_result::ignored, result.last_result);
+
+  result = pool.fire_all_instances(static_cast<trigger>(3), batch_policy::stop_on_failure);
+  ASSERT_EQ(0U, result.consumed);
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(fire_result::ignored, result.last_result);
+}
+
+TEST(EnumStateMachinePool, WhenEntryActionFiresThePool_ThenOuterFireSeesCurrentStates)
+{
+  TPool pool(2, state::A);
+  bool nested = false;
+  pool.configure(state::A)
+    .permit(trigger::X, state::B)
+    .ignore(trigger::Y);
+  pool.configure(state::B)
+    .ignore(trigger::X)
+    .permit(trigger::Y, state::C)
+    .on_entry([&](const TPool::TTransition&)
+      {
+        if (!nested)
+        {
+          nested = true;
+          pool.fire_all_instances(trigger::Y);
+        }
+      });
+  int reentered = 0;
+  pool.configure(state::C)
+    .ignore(trigger::X)
+    .on_entry([&](const TPool::TTransition& t)
+      {
+        if (t.source() == state::C)
+        {
+          ++reentered;
+        }
+      });
+  pool.freeze();
+  pool.add(state::B);
+  pool.add(state::B);
+
+  auto result = pool.fire_all_instances(trigger::X);
+
+  ASSERT_EQ(4U, result.consumed);
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(0, reentered);
+  ASSERT_EQ(state::C, pool.state(0));
+  ASSERT_EQ(state::B, pool.state(1));
+  ASSERT_EQ(state::C, pool.state(2));
+  ASSERT_EQ(state::C, pool.state(3));
+}
+
+TEST(EnumStateMachinePool, WhenInstanceTransitions_ThenTransitionCarriesItsIdentifier)
+{
+  TPool pool(3, state::A);
+  pool.configure(state::A).permit(trigger::X, state::B);
+  pool.configure(state::B).permit_if(trigger::Y, state::A, []() { return true; });
+  pool.freeze();
+
+  std::vector<std::size_t> identifiers;
+  pool.on_transition([&](std::size_t id, const TPool::TTransition& t)
+    {
+      ASSERT_EQ(id, t.instance_id());
+      identifiers.push_back(t.instance_id());
+    });
+  pool.fire_all_instances(trigger::X);
+  pool.try_fire(1, trigger::Y);
+
+  ASSERT_EQ(std::vector<std::size_t>({ 0, 1, 2, 1 }), identifiers);
+}
+
+TEST(EnumStateMachinePool, WhenReentryConfigured_ThenActionsRunWithoutChangingState)
+{
+  TPool pool(2, state::C);
+  int reentries = 0;
+  pool.configure(state::C)
+    .permit_reentry(trigger::Y)
+    .on_entry([&](const TPool::TTransition&) { ++reentries; });
+  pool.freeze();
+
+  auto result = pool.fire_all_instances(trigger::Y);
+
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(fire_result::transitioned, result.last_result);
+  ASSERT_EQ(2, reentries);
+  ASSERT_EQ(state::C, pool.state(1));
+}
+
+TEST(EnumStateMachinePool, WhenGuarded_ThenGuardIsEvaluatedForEachInstance)
+{
+  TPool pool(4, state::A);
+  int evaluations = 0;
+  pool.configure(state::A).permit_if(trigger::X, state::B, [&]{ return ++evaluations % 2 == 0; });
+  pool.configure(state::B);
+  pool.freeze();
+
+  auto result = pool.fire_all_instances(trigger::X);
+
+  ASSERT_EQ(4, evaluations);
+  ASSERT_EQ(2U, result.failed);
+  ASSERT_EQ(state::A, pool.state(0));
+  ASSERT_EQ(state::B, pool.state(1));
+  ASSERT_EQ(state::A, pool.state(2));
+  ASSERT_EQ(state::B, pool.state(3));
+}
+
+TEST(EnumStateMachinePool, WhenInSubstate_ThenSuperstateTransitionsApply)
+{
+  TPool pool(2, state::B);
+  pool.configure(state::B).sub_state_of(state::C);
+  pool.configure(state::C).permit(trigger::Z, state::A);
+  pool.freeze();
+
+  ASSERT_TRUE(pool.is_in_state(0, state::C));
+  pool.fire_all_instances(trigger::Z);
+
+  ASSERT_EQ(state::A, pool.state(0));
+  ASSERT_EQ(state::A, pool.state(1));
+}
+
+TEST(EnumStateMachinePool, WhenStopOnFailure_ThenStopsAtFirstUnhandledInstance)
+{
+  TPool pool(2, state::A);
+  pool.configure(state::A).permit(trigger::X, state::B);
+  pool.freeze();
+  pool.add(state::C);
+  pool.add(state::A);
+
+  auto result = pool.fire_all_instances(trigger::X, batch_policy::stop_on_failure);
+
+  ASSERT_EQ(3U, result.consumed);
+  ASSERT_EQ(1U, result.failed);
+  ASSERT_EQ(state::B, pool.state(1));
+  ASSERT_EQ(state::A, pool.state(3));
+}
+
+TEST(EnumStateMachinePool, WhenParametersRequired_ThenInstancesReportBadParameters)
+{
+  TPool pool(2, state::A);
+  auto x = pool.set_trigger_parameters<int>(trigger::X);
+  int assigned = 0;
+  pool.configure(state::A).permit(trigger::X, state::B);
+  pool.configure(state::B).on_entry_from(x, [&](const TPool::TTransition&, int i) { assigned = i; });
+  pool.freeze();
+
+  auto result = pool.fire_all_instances(trigger::X);
+  ASSERT_EQ(2U, result.failed);
+  ASSERT_EQ(fire_result::bad_parameters, result.last_result);
+
+  ASSERT_EQ(fire_result::transitioned, pool.try_fire(1, x, 7));
+  ASSERT_EQ(7, assigned);
+  ASSERT_EQ(state::B, pool.state(1));
+}
+
+TEST(EnumStateMachinePool, WhenFireIdsAndTriggers_ThenEachInstanceReceivesItsTrigger)
+{
+  TPool pool(3, state::A);
+  int entries = 0, exits = 0;
+  configure(pool, entries, exits);
+
+  const std::size_t ids[] = { 2, 0, 2 };
+  const trigger triggers[] = { trigger::X, trigger::X, trigger::Y };
+  auto result = pool.fire(ids, triggers);
+
+  ASSERT_EQ(3U, result.consumed);
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(state::B, pool.state(0));
+  ASSERT_EQ(state::A, pool.state(1));
+  ASSERT_EQ(state::A, pool.state(2));
+}
+
+TEST(EnumStateMachinePool, WhenIdentifierIsOutsidePool_ThenRaisesError)
+{
+  TPool pool(2, state::A);
+  pool.configure(state::A).permit(trigger::X, state::B);
+  const std::size_t ids[] = { 0, 2 };
+  const trigger triggers[] = { trigger::X, trigger::X };
+
+  ASSERT_THROW(pool.state(2), stateless::error);
+  ASSERT_THROW(pool.is_in_state(2, state::A), stateless::error);
+  ASSERT_THROW(pool.try_fire(2, trigger::X), stateless::error);
+  ASSERT_THROW(pool.fire(ids, triggers), stateless::error);
+  ASSERT_EQ(state::B, pool.state(0));
+}
+
+TEST(EnumStateMachinePool, WhenManyInstances_ThenEveryInstructionSetGivesTheSameStates)
+{
+  std::vector<detail::simd_level> levels(1, detail::simd_level::scalar);
+  if (detail::detected_simd_level() != detail::simd_level::scalar)
+  {
+    levels.push_back(detail::simd_level::sse42);
+  }
+  if (detail::detected_simd_level() == detail::simd_level::avx2)
+  {
+    levels.push_back(detail::simd_level::avx2);
+  }
+
+  std::vector<state> expected;
+  std::vector<std::size_t> expected_transitions;
+  for (auto level : levels)
+  {
+    TPool pool(0, state::A);
+    int entries = 0, exits = 0;
+    configure(pool, entries, exits);
+    pool.freeze();
+    for (std::size_t i = 0; i < 10007; ++i)
+    {
+      pool.add(static_cast<state>(i * 7 % 3));
+    }
+    std::vector<std::size_t> transitioned;
+    pool.on_transition([&](std::size_t id, const TPool::TTransition&) { transitioned.push_back(id); });
+
+    pool.fire_all_instances(trigger::X, batch_policy::continue_on_failure, level);
+    auto result = pool.fire_all_instances(trigger::Y, batch_policy::continue_on_failure, level);
+    ASSERT_EQ(10007U, result.consumed);
+
+    std::vector<state> states;
+    for (std::size_t id = 0; id < pool.size(); ++id)
+    {
+      states.push_back(pool.state(id));
+    }
+    if (expected.empty())
+    {
+      expected = states;
+      expected_transitions = transitioned;
+    }
+    ASSERT_EQ(expected, states);
+    ASSERT_EQ(expected_transitions, transitioned);
+  }
+}
+
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/inplace_function.hpp>
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+bool return_true()
+{
+  return true;
+}
+
+TEST(InplaceFunction, WhenDefaultConstructed_ThenItIsEmpty)
+{
+  inplace_function<void()> f;
+
+  ASSERT_FALSE(f);
+  ASSERT_THROW(f(), std::bad_function_call);
+}
+
+TEST(InplaceFunction, WhenConstructedFromFunction_ThenItIsInvoked)
+{
+  inplace_function<bool()> f(return_true);
+
+  ASSERT_TRUE(static_cast<bool>(f));
+  ASSERT_TRUE(f());
+}
+
+TEST(InplaceFunction, WhenCopied_ThenCapturesAreCopied)
+{
+  const std::string captured("a string that is too long for small string optimization");
+  inplace_function<std::string(int)> f(
+    [=](int i){ return captured + std::to_string(i); });
+
+  auto copy = f;
+  inplace_function<std::string(int)> assigned;
+  assigned = copy;
+
+  EXPECT_EQ(captured + "1", f(1));
+  EXPECT_EQ(captured + "2", copy(2));
+  EXPECT_EQ(captured + "3", assigned(3));
+}
+
+TEST(InplaceFunction, WhenDestroyed_ThenCapturesAreReleased)
+{
+  auto resource = std::make_shared<int>(0);
+  {
+    inplace_function<void()> f([resource](){});
+    auto copy = f;
+    ASSERT_EQ(3, resource.use_count());
+  }
+  ASSERT_EQ(1, resource.use_count());
+}
+
+TEST(InplaceFunction, WhenWrappingResultOfDifferentType_ThenResultIsConverted)
+{
+  int calls = 0;
+  inplace_function<void(int)> discard([&](int i){ ++calls; return i; });
+  inplace_function<long()> widen([](){ return 42; });
+
+  discard(1);
+
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(42L, widen());
+}
+
+TEST(InplaceFunction, WhenWrappingStdFunction_ThenItFits)
+{
+  std::function<int(int)> wrapped = [](int i){ return i * 2; };
+  inplace_function<int(int)> f(wrapped);
+
+  EXPECT_EQ(4, f(2));
+}
+
+}
@@ -0,0 +1,244 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/machine_definition.hpp>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef machine_definition<state, trigger> TDefinition;
+#else
+using TDefinition = machine_definition<state, trigger>;
+#endif
+
+TEST(MachineDefinition, WhenNotFrozen_ThenInstancesCannotBeCreated)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+
+  ASSERT_THROW(definition.create_instance(state::A), stateless::error);
+}
+
+TEST(MachineDefinition, WhenFrozen_ThenCannotBeReconfigured)
+{
+  TDefinition definition;
+  definition.configure(state::A);
+  definition.freeze();
+
+  ASSERT_THROW(definition.configure(state::A), stateless::error);
+  ASSERT_THROW(definition.set_trigger_parameters<int>(trigger::X), stateless::error);
+  ASSERT_THROW(definition.freeze(), stateless::error);
+}
+
+TEST(MachineDefinition, WhenStateNotConfigured_ThenInstanceCannotBeCreated)
+{
+  TDefinition definition;
+  definition.configure(state::A);
+  definition.freeze();
+
+  ASSERT_THROW(definition.create_instance(state::C), stateless::error);
+}
+
+TEST(MachineDefinition, WhenInstanceCreated_ThenItIsTheSizeOfAPointer)
+{
+  ASSERT_EQ(sizeof(void*), sizeof(TDefinition::TInstance));
+}
+
+TEST(MachineDefinition, WhenInstancesFired_ThenEachKeepsItsOwnState)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::B).permit(trigger::Y, state::C);
+  definition.freeze();
+
+  auto first = definition.create_instance(state::A);
+  auto second = definition.create_instance(state::A);
+  definition.fire(first, trigger::X);
+  definition.fire(first, trigger::Y);
+  definition.fire(second, trigger::X);
+
+  ASSERT_EQ(state::C, first.state());
+  ASSERT_EQ(state::B, second.state());
+}
+
+TEST(MachineDefinition, WhenTransitioning_ThenActionsAreInvoked)
+{
+  TDefinition definition;
+  std::vector<std::string> actions;
+  definition.configure(state::A)
+    .permit(trigger::X, state::B)
+    .on_exit([&](const TDefinition::TTransition&) { actions.push_back("exit A"); });
+  definition.configure(state::B)
+    .on_entry([&](const TDefinition::TTransition&) { actions.push_back("enter B"); });
+  definition.on_transition([&](const TDefinition::TTransition&) { actions.push_back("transition"); });
+  definition.freeze();
+
+  auto instance = definition.create_instance(state::A);
+  definition.fire(instance, trigger::X);
+
+  ASSERT_EQ(3U, actions.size());
+  ASSERT_EQ("exit A", actions[0]);
+  ASSERT_EQ("transition", actions[1]);
+  ASSERT_EQ("enter B", actions[2]);
+}
+
+TEST(MachineDefinition, WhenInstanceTransitions_ThenActionsSeeWhichInstance)
+{
+  TDefinition definition;
+  std::vector<std::size_t> ids;
+  definition.configure(state::A)
+    .permit(trigger::X, state::B)
+    .on_exit([&](const TDefinition::TTransition& t) { ids.push_back(t.instance_id()); });
+  definition.configure(state::B)
+    .on_entry([&](const TDefinition::TTransition& t) { ids.push_back(t.instance_id()); });
+  definition.on_transition([&](const TDefinition::TTransition& t) { ids.push_back(t.instance_id()); });
+  definition.freeze();
+
+  auto first = definition.create_instance(state::A);
+  auto second = definition.create_instance(state::A);
+  definition.fire(second, trigger::X);
+  definition.fire(first, trigger::X);
+
+  const auto first_id = static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(&first));
+  const auto second_id = static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(&second));
+  ASSERT_EQ(
+    std::vector<std::size_t>({ second_id, second_id, second_id, first_id, first_id, first_id }),
+    ids);
+}
+
+TEST(MachineDefinition, WhenInSubstate_ThenSuperstateIsQueried)
+{
+  TDefinition definition;
+  definition.configure(state::B).sub_state_of(state::C).permit(trigger::X, state::A);
+  definition.configure(state::C).permit(trigger::Y, state::A);
+  definition.configure(state::A);
+  definition.freeze();
+
+  auto instance = definition.create_instance(state::B);
+
+  ASSERT_TRUE(definition.is_in_state(instance, state::C));
+  ASSERT_FALSE(definition.is_in_state(instance, state::A));
+  ASSERT_TRUE(definition.can_fire(instance, trigger::Y));
+  ASSERT_FALSE(definition.can_fire(instance, trigger::Z));
+  ASSERT_EQ(2U, definition.permitted_triggers(instance).size());
+
+  definition.fire(instance, trigger::Y);
+  ASSERT_EQ(state::A, instance.state());
+}
+
+TEST(MachineDefinition, WhenTriggerUnhandled_ThenReportedByValueOrError)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.freeze();
+
+  auto instance = definition.create_instance(state::A);
+
+  ASSERT_EQ(fire_result::unhandled, definition.try_fire(instance, trigger::Y));
+  ASSERT_THROW(definition.fire(instance, trigger::Y), stateless::error);
+  ASSERT_EQ(state::A, instance.state());
+}
+
+TEST(MachineDefinition, WhenParametersSuppliedToFire_ThenTheyArePassedToEntryAction)
+{
+  TDefinition definition;
+  auto x = definition.set_trigger_parameters<std::string, int>(trigger::X);
+  definition.configure(state::A).permit(trigger::X, state::B);
+
+  std::string assigned_string;
+  int assigned_int = 0;
+  definition.configure(state::B)
+    .on_entry_from(
+      x,
+      [&](const TDefinition::TTransition&, const std::string& s, int i)
+      {
+        assigned_string = s;
+        assigned_int = i;
+      });
+  definition.freeze();
+
+  auto instance = definition.create_instance(state::A);
+  definition.fire(instance, x, std::string("5"), 5);
+
+  ASSERT_EQ("5", assigned_string);
+  ASSERT_EQ(5, assigned_int);
+}
+
+TEST(MachineDefinition, WhenTriggersDeferred_ThenDrainFiresThemInOrder)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::B).permit(trigger::Y, state::C);
+  definition.freeze();
+
+  TDefinition::TDeferredInstance instance(definition.create_instance(state::A));
+  std::thread producer([&]
+    {
+      instance.push_deferred_trigger(trigger::X);
+      instance.push_deferred_trigger(trigger::Y);
+    });
+  producer.join();
+
+  ASSERT_EQ(2U, definition.drain_deferred_triggers(instance));
+  ASSERT_EQ(state::C, instance.state());
+}
+
+TEST(MachineDefinition, WhenSharedBetweenThreads_ThenInstancesAreFiredIndependently)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::B).permit(trigger::X, state::A);
+  definition.freeze();
+
+  std::vector<TDefinition::TInstance> instances(4, definition.create_instance(state::A));
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < instances.size(); ++i)
+  {
+    threads.push_back(std::thread([&, i]
+      {
+        for (std::size_t n = 0; n < 1001 + i; ++n)
+        {
+          definition.fire(instances[i], trigger::X);
+        }
+      }));
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_EQ(state::B, instances[0].state());
+  ASSERT_EQ(state::A, instances[1].state());
+  ASSERT_EQ(state::B, instances[2].state());
+  ASSERT_EQ(state::A, instances[3].state());
+}
+
+}
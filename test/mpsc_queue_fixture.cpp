@@ -0,0 +1,188 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/detail/mpsc_queue.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace stateless::detail;
+
+namespace
+{
+
+TEST(MpscQueue, WhenPushed_ThenPoppedInOrder)
+{
+  mpsc_queue<std::string> q(4);
+  ASSERT_TRUE(q.push("a"));
+  ASSERT_TRUE(q.push("b"));
+
+  std::string value;
+  ASSERT_TRUE(q.pop(value));
+  EXPECT_EQ("a", value);
+  ASSERT_TRUE(q.pop(value));
+  EXPECT_EQ("b", value);
+  ASSERT_FALSE(q.pop(value));
+}
+
+TEST(MpscQueue, WhenFull_ThenPushFailsUntilPopped)
+{
+  mpsc_queue<int> q(2);
+  ASSERT_TRUE(q.push(1));
+  ASSERT_TRUE(q.push(2));
+  ASSERT_FALSE(q.push(3));
+
+  int value = 0;
+  ASSERT_TRUE(q.pop(value));
+  ASSERT_TRUE(q.push(3));
+  ASSERT_TRUE(q.pop(value));
+  EXPECT_EQ(2, value);
+  ASSERT_TRUE(q.pop(value));
+  EXPECT_EQ(3, value);
+}
+
+struct no_default
+{
+  explicit no_default(int v) : value(v) {}
+  int value;
+};
+
+TEST(MpscQueue, WhenValueIsNotDefaultConstructible_ThenItIsPeekedAndPopped)
+{
+  mpsc_queue<no_default> q(2);
+  ASSERT_EQ(nullptr, q.front());
+  ASSERT_TRUE(q.push(no_default(7)));
+
+  ASSERT_NE(nullptr, q.front());
+  EXPECT_EQ(7, q.front()->value);
+  EXPECT_EQ(7, q.front()->value);
+  q.pop();
+  ASSERT_EQ(nullptr, q.front());
+}
+
+TEST(MpscQueue, WhenDestroyed_ThenQueuedValuesAreDestroyed)
+{
+  auto value = std::make_shared<int>(0);
+  {
+    mpsc_queue<std::shared_ptr<int>> q(4);
+    ASSERT_TRUE(q.push(value));
+    ASSERT_TRUE(q.push(value));
+    q.pop();
+    EXPECT_EQ(2, value.use_count());
+  }
+  EXPECT_EQ(1, value.use_count());
+}
+
+struct throws_on_copy
+{
+  explicit throws_on_copy(int v) : value(v) {}
+
+  throws_on_copy(const throws_on_copy& other)
+    : value(other.value)
+  {
+    if (value < 0)
+    {
+      throw std::runtime_error("copy failed");
+    }
+  }
+
+  int value;
+};
+
+TEST(MpscQueue, WhenCopyThrows_ThenConsumerSkipsTheSlot)
+{
+  mpsc_queue<throws_on_copy> q(2);
+  ASSERT_TRUE(q.push(throws_on_copy(1)));
+  ASSERT_THROW(q.push(throws_on_copy(-1)), std::runtime_error);
+
+  ASSERT_NE(nullptr, q.front());
+  EXPECT_EQ(1, q.front()->value);
+  q.pop();
+  ASSERT_EQ(nullptr, q.front());
+
+  ASSERT_TRUE(q.push(throws_on_copy(2)));
+  ASSERT_TRUE(q.push(throws_on_copy(3)));
+  EXPECT_EQ(2, q.front()->value);
+  q.pop();
+  EXPECT_EQ(3, q.front()->value);
+  q.pop();
+  ASSERT_EQ(nullptr, q.front());
+}
+
+TEST(LazyMpscQueue, WhenNothingIsPushed_ThenFrontIsEmpty)
+{
+  lazy_mpsc_queue<std::string> q(4);
+  ASSERT_EQ(nullptr, q.front());
+  ASSERT_TRUE(q.push("a"));
+  ASSERT_NE(nullptr, q.front());
+  EXPECT_EQ("a", *q.front());
+  q.pop();
+  ASSERT_EQ(nullptr, q.front());
+}
+
+TEST(MpscQueue, WhenManyProducers_ThenEveryValueIsPoppedOnceInPerProducerOrder)
+{
+  const std::size_t producers = 4, values = 10000;
+  mpsc_queue<std::size_t> q(64);
+
+  std::vector<std::thread> threads;
+  for (std::size_t p = 0; p < producers; ++p)
+  {
+    threads.push_back(std::thread([&q, p, values]
+      {
+        for (std::size_t i = 0; i < values; ++i)
+        {
+          while (!q.push(p * values + i))
+          {
+            std::this_thread::yield();
+          }
+        }
+      }));
+  }
+
+  std::vector<std::size_t> next(producers, 0);
+  for (std::size_t received = 0; received < producers * values;)
+  {
+    std::size_t value;
+    if (q.pop(value))
+    {
+      const auto p = value / values;
+      ASSERT_EQ(next[p], value % values);
+      ++next[p];
+      ++received;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  std::size_t value;
+  ASSERT_FALSE(q.pop(value));
+}
+
+}
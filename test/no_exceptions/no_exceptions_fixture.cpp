@@ -0,0 +1,135 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/enum_state_machine.hpp>
+#include <stateless++/state_machine_actor.hpp>
+#include <stateless++/state_machine.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+#if !defined(STATELESS_NO_EXCEPTIONS)
+#error "This test must be built without exception support."
+#endif
+
+using namespace stateless;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef state_machine<state, trigger> TStateMachine;
+typedef enum_state_machine<state, trigger, 3, 3> TEnumStateMachine;
+#else
+using TStateMachine = state_machine<state, trigger>;
+using TEnumStateMachine = enum_state_machine<state, trigger, 3, 3>;
+#endif
+
+void exit_with_message(const char* what)
+{
+  std::fprintf(stderr, "handled: %s\n", what);
+  std::exit(3);
+}
+
+TEST(NoExceptions, WhenConfiguredAndFired_ThenTransitions)
+{
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<int>(trigger::X);
+  int entered = 0;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B)
+    .on_entry_from(x, [&](const TStateMachine::TTransition&, int i){ entered = i; })
+    .permit(trigger::Y, state::A);
+  sm.freeze();
+
+  sm.fire(x, 42);
+
+  ASSERT_EQ(state::B, sm.state());
+  ASSERT_EQ(42, entered);
+  ASSERT_TRUE(sm.is_in_state(state::B));
+  ASSERT_TRUE(sm.can_fire(trigger::Y));
+}
+
+TEST(NoExceptions, WhenTryFire_ThenFailuresAreReportedAsStatus)
+{
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<int>(trigger::X);
+  sm.configure(state::A)
+    .permit(trigger::X, state::B)
+    .permit_if(trigger::Y, state::B, [](){ return true; })
+    .permit_if(trigger::Y, state::C, [](){ return true; });
+
+  EXPECT_EQ(fire_result::bad_parameters, sm.try_fire(trigger::X));
+  EXPECT_EQ(fire_result::guard_conflict, sm.try_fire(trigger::Y));
+  EXPECT_EQ(fire_result::unhandled, sm.try_fire(trigger::Z));
+  EXPECT_EQ(fire_result::transitioned, sm.try_fire(x, 1));
+}
+
+TEST(NoExceptions, WhenEnumStateMachineFired_ThenTransitions)
+{
+  TEnumStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).sub_state_of(state::C);
+
+  ASSERT_EQ(fire_result::transitioned, sm.try_fire(trigger::X));
+  ASSERT_TRUE(sm.is_in_state(state::C));
+  ASSERT_EQ(fire_result::unhandled, sm.try_fire(trigger::X));
+}
+
+TEST(NoExceptionsDeathTest, WhenUnhandledTriggerIsFired_ThenDefaultHandlerAborts)
+{
+  TStateMachine sm(state::A);
+
+  ASSERT_DEATH(sm.fire(trigger::X), "No valid leaving transitions");
+}
+
+TEST(NoExceptionsDeathTest, WhenErrorHandlerIsInstalled_ThenErrorsAreReportedToIt)
+{
+  TStateMachine sm(state::A);
+  sm.freeze();
+
+  ASSERT_EXIT(
+    {
+      set_error_handler(&exit_with_message);
+      sm.configure(state::A);
+    },
+    ::testing::ExitedWithCode(3),
+    "handled: The state machine is frozen");
+}
+
+TEST(NoExceptions, WhenErrorHandlerIsReset_ThenPreviousHandlerIsReturned)
+{
+  auto previous = set_error_handler(&exit_with_message);
+  ASSERT_EQ(&exit_with_message, set_error_handler(previous));
+  ASSERT_EQ(previous, set_error_handler(nullptr));
+}
+
+TEST(NoExceptions, WhenActorRequestsTrigger_ThenFutureHoldsTransition)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  state_machine_actor<state, trigger> actor(sm);
+
+  ASSERT_EQ(state::B, actor.request(trigger::X).get().transition->destination());
+}
+
+}
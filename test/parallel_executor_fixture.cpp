@@ -0,0 +1,137 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/parallel_executor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+
+namespace
+{
+
+TEST(ParallelExecutor, WhenConstructedWithThreadCount_ThenConcurrencyIsThatCount)
+{
+  parallel_executor executor(3);
+  ASSERT_EQ(3U, executor.concurrency());
+}
+
+TEST(ParallelExecutor, WhenForEachChunk_ThenEveryIndexIsProcessedOnce)
+{
+  parallel_executor executor(4);
+  std::vector<std::atomic<int>> visits(10001);
+  for (auto& v : visits)
+  {
+    v = 0;
+  }
+  std::atomic<std::size_t> chunks(0);
+
+  executor.for_each_chunk(visits.size(), 100,
+    [&](std::size_t chunk, std::size_t first, std::size_t last)
+    {
+      ASSERT_EQ(chunk * 100, first);
+      ASSERT_LE(last - first, 100U);
+      for (auto i = first; i < last; ++i)
+      {
+        ++visits[i];
+      }
+      ++chunks;
+    });
+
+  ASSERT_EQ(101U, chunks);
+  for (const auto& v : visits)
+  {
+    ASSERT_EQ(1, v);
+  }
+}
+
+TEST(ParallelExecutor, WhenCalledRepeatedly_ThenEachCallCompletes)
+{
+  parallel_executor executor(3);
+  for (int call = 0; call < 200; ++call)
+  {
+    std::atomic<std::size_t> total(0);
+    executor.for_each_chunk(call, 7,
+      [&](std::size_t, std::size_t first, std::size_t last) { total += last - first; });
+    ASSERT_EQ(static_cast<std::size_t>(call), total);
+  }
+}
+
+TEST(ParallelExecutor, WhenOneShareIsBlocked_ThenOtherThreadsStealItsChunks)
+{
+  parallel_executor executor(2);
+  std::atomic<std::size_t> done(0);
+  bool others_finished = false;
+
+  executor.for_each_chunk(64, 1,
+    [&](std::size_t chunk, std::size_t, std::size_t)
+    {
+      if (chunk != 0)
+      {
+        ++done;
+        return;
+      }
+      // Block the thread holding the first share until the rest is done,
+      // which only happens if another thread steals the rest of that share.
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (done < 63 && std::chrono::steady_clock::now() < deadline)
+      {
+        std::this_thread::yield();
+      }
+      others_finished = done == 63;
+    });
+
+  ASSERT_TRUE(others_finished);
+}
+
+TEST(ParallelExecutor, WhenBodyThrows_ThenExceptionIsRethrownInCaller)
+{
+  parallel_executor executor(3);
+
+  ASSERT_THROW(
+    executor.for_each_chunk(100, 1,
+      [](std::size_t chunk, std::size_t, std::size_t)
+      {
+        if (chunk == 42)
+        {
+          throw std::runtime_error("chunk failed");
+        }
+      }),
+    std::runtime_error);
+
+  std::atomic<std::size_t> total(0);
+  executor.for_each_chunk(10, 3,
+    [&](std::size_t, std::size_t first, std::size_t last) { total += last - first; });
+  ASSERT_EQ(10U, total);
+}
+
+TEST(ParallelExecutor, WhenChunkSizeIsZero_ThenRaisesError)
+{
+  parallel_executor executor(1);
+  ASSERT_THROW(
+    executor.for_each_chunk(10, 0, [](std::size_t, std::size_t, std::size_t) {}),
+    stateless::error);
+}
+
+}
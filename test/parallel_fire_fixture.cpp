@@ -0,0 +1,104 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/parallel_fire.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef machine_definition<state, trigger> TDefinition;
+typedef state_machine_pool<state, trigger> TPool;
+#else
+using TDefinition = machine_definition<state, trigger>;
+using TPool = state_machine_pool<state, trigger>;
+#endif
+
+TEST(ParallelFire, WhenFiredInParallel_ThenEveryInstanceTransitionsOnce)
+{
+  TDefinition definition;
+  std::atomic<int> entries(0);
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::B)
+    .permit(trigger::X, state::A)
+    .on_entry([&](const TDefinition::TTransition&) { ++entries; });
+  definition.freeze();
+
+  TPool pool(definition, 10000, state::A);
+  parallel_executor executor(4);
+
+  auto reports = parallel_fire_all_instances(executor, pool, trigger::X, 256);
+
+  ASSERT_EQ(40U, reports.size());
+  ASSERT_EQ(10000, entries);
+  auto total = summarize(reports);
+  ASSERT_EQ(10000U, total.consumed);
+  ASSERT_EQ(0U, total.failed);
+  ASSERT_EQ(fire_result::transitioned, total.last_result);
+  for (std::size_t id = 0; id < pool.size(); ++id)
+  {
+    ASSERT_EQ(state::B, pool.state(id));
+  }
+}
+
+TEST(ParallelFire, WhenInstancesDoNotHandleTrigger_ThenTheyAreReportedPerChunk)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::C);
+  definition.freeze();
+
+  TPool pool(definition, 0, state::A);
+  for (std::size_t i = 0; i < 100; ++i)
+  {
+    pool.add(i % 10 == 3 ? state::C : state::A);
+  }
+  parallel_executor executor(3);
+
+  auto reports = parallel_fire_all_instances(executor, pool, trigger::X, 25);
+
+  ASSERT_EQ(4U, reports.size());
+  for (std::size_t chunk = 0; chunk < reports.size(); ++chunk)
+  {
+    const auto& report = reports[chunk];
+    ASSERT_EQ(chunk * 25, report.first);
+    ASSERT_EQ(chunk * 25 + 25, report.last);
+    for (const auto& failure : report.failures)
+    {
+      ASSERT_GE(failure.id, report.first);
+      ASSERT_LT(failure.id, report.last);
+      ASSERT_EQ(3U, failure.id % 10);
+      ASSERT_EQ(fire_result::unhandled, failure.result);
+    }
+  }
+  ASSERT_EQ(10U, summarize(reports).failed);
+  ASSERT_EQ(state::C, pool.state(3));
+  ASSERT_EQ(state::B, pool.state(4));
+}
+
+}
@@ -0,0 +1,230 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/state_machine_actor.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef state_machine<state, trigger> TStateMachine;
+typedef state_machine_actor<state, trigger> TActor;
+#else
+using TStateMachine = state_machine<state, trigger>;
+using TActor = state_machine_actor<state, trigger>;
+#endif
+
+void exit_on_posted_error(const char* what)
+{
+  std::fprintf(stderr, "raised: %s\n", what);
+  std::_Exit(3);
+}
+
+TEST(StateMachineActor, WhenTriggersPosted_ThenFiredInOrderOnActorThread)
+{
+  TStateMachine sm(state::A);
+  std::vector<state> entered;
+  std::vector<std::thread::id> threads;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::Y, state::C);
+  sm.configure(state::C).permit(trigger::Z, state::A);
+  sm.on_transition([&](const TStateMachine::TTransition& t)
+    {
+      entered.push_back(t.destination());
+      threads.push_back(std::this_thread::get_id());
+    });
+
+  {
+    TActor actor(sm);
+    actor.post(trigger::X);
+    actor.post(trigger::Y);
+    actor.post(trigger::Z);
+  }
+
+  ASSERT_EQ(std::vector<state>({ state::B, state::C, state::A }), entered);
+  ASSERT_NE(std::this_thread::get_id(), threads.front());
+  ASSERT_EQ(threads.front(), threads.back());
+}
+
+TEST(StateMachineActor, WhenParameterisedTriggerPosted_ThenArgumentsAreCopied)
+{
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<std::string>(trigger::X);
+  std::string received;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B)
+    .on_entry_from(x, [&](const TStateMachine::TTransition&, const std::string& s)
+      {
+        received = s;
+      });
+
+  {
+    TActor actor(sm);
+    std::string argument("copied");
+    actor.post(x, argument);
+    argument.clear();
+  }
+
+  ASSERT_EQ("copied", received);
+}
+
+TEST(StateMachineActor, WhenRequested_ThenFutureHoldsTransition)
+{
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<int>(trigger::X);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).ignore(trigger::Y);
+  TActor actor(sm);
+
+  auto transitioned = actor.request(x, 42);
+  auto ignored = actor.request(trigger::Y);
+
+  const auto t = transitioned.get();
+  ASSERT_EQ(fire_result::transitioned, t.result);
+  ASSERT_EQ(state::A, t.transition->source());
+  ASSERT_EQ(state::B, t.transition->destination());
+  ASSERT_EQ(trigger::X, t.transition->trigger());
+  const auto i = ignored.get();
+  ASSERT_EQ(fire_result::ignored, i.result);
+  ASSERT_EQ(nullptr, i.transition);
+}
+
+TEST(StateMachineActor, WhenEntryActionFires_ThenFutureHoldsTransitionOfRequestedTrigger)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B)
+    .permit(trigger::Y, state::C)
+    .on_entry([&](const TStateMachine::TTransition&) { sm.fire(trigger::Y); });
+  TActor actor(sm);
+
+  const auto t = actor.request(trigger::X).get();
+
+  ASSERT_EQ(fire_result::transitioned, t.result);
+  ASSERT_EQ(state::A, t.transition->source());
+  ASSERT_EQ(state::B, t.transition->destination());
+  ASSERT_EQ(state::C, actor.machine().state());
+}
+
+TEST(StateMachineActor, WhenUnhandledTriggerActionReturns_ThenFutureHoldsUnhandled)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A);
+  sm.on_unhandled_trigger([](const state&, const trigger&) {});
+  TActor actor(sm);
+
+  const auto t = actor.request(trigger::X).get();
+
+  ASSERT_EQ(fire_result::unhandled, t.result);
+  ASSERT_EQ(nullptr, t.transition);
+}
+
+TEST(StateMachineActor, WhenRequestedTriggerUnhandled_ThenFutureHoldsError)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A);
+  TActor actor(sm);
+
+  auto result = actor.request(trigger::X);
+
+  ASSERT_THROW(result.get(), stateless::error);
+}
+
+TEST(StateMachineActor, WhenPostedTriggerRaises_ThenErrorHandlerIsCalledAndActorContinues)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::Y, state::B);
+  std::atomic<int> errors(0);
+  TActor actor(sm, [&](std::exception_ptr e)
+    {
+      ASSERT_THROW(std::rethrow_exception(e), stateless::error);
+      ++errors;
+    });
+
+  actor.post(trigger::X);
+  auto result = actor.request(trigger::Y);
+
+  ASSERT_EQ(state::B, result.get().transition->destination());
+  ASSERT_EQ(1, errors.load());
+}
+
+TEST(StateMachineActorDeathTest, WhenPostedTriggerRaisesWithoutHandler_ThenErrorIsRaised)
+{
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  ASSERT_EXIT(
+    {
+      set_error_handler(&exit_on_posted_error);
+      TStateMachine sm(state::A);
+      sm.configure(state::A).permit(trigger::X, state::B);
+      sm.configure(state::B)
+        .on_entry([](const TStateMachine::TTransition&) { throw std::runtime_error("entry failed"); });
+      TActor actor(sm);
+      actor.post(trigger::X);
+    },
+    ::testing::ExitedWithCode(3),
+    "raised: entry failed");
+}
+
+TEST(StateMachineActor, WhenManyThreadsPost_ThenEveryTriggerIsFired)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::X, state::A);
+  int transitions = 0;
+  sm.on_transition([&](const TStateMachine::TTransition&) { ++transitions; });
+
+  {
+    TActor actor(sm);
+    std::vector<std::thread> posters;
+    for (int t = 0; t < 4; ++t)
+    {
+      posters.push_back(std::thread([&]
+        {
+          for (int i = 0; i < 1000; ++i)
+          {
+            actor.post(trigger::X);
+          }
+        }));
+    }
+    for (auto& poster : posters)
+    {
+      poster.join();
+    }
+  }
+
+  ASSERT_EQ(4000, transitions);
+  ASSERT_EQ(state::A, sm.state());
+}
+
+}
@@ -15,6 +15,14 @@
  */
 
 #include <stateless++/state_machine.hpp>
+#include <stateless++/strand.hpp>
+
+#include <atomic>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <state.hpp>
 #include <trigger.hpp>
@@ -67,6 +75,23 @@ TEST(StateMachine, WhenStateIsStoredExternally_ThenItIsRetrieved)
   ASSERT_EQ(state::C, sm.state());
 }
 
+TEST(StateMachine, WhenExternalStateIsChangedDirectly_ThenTheMachineResynchronizes)
+{
+  state s = state::B;
+  TStateMachine sm([&](){ return s; }, [&](const state& new_s){ s = new_s; });
+
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::X, state::C);
+
+  ASSERT_TRUE(sm.can_fire(trigger::X));
+  s = state::A;
+  ASSERT_EQ(state::A, sm.state());
+
+  sm.fire(trigger::X);
+
+  ASSERT_EQ(state::B, s);
+}
+
 TEST(StateMachine, WhenSubstate_ThenItIsIncludedInCurrentState)
 {
   TStateMachine sm(state::B);
@@ -201,6 +226,59 @@ TEST(StateMachine, WhenParametersSuppliedToFire_ThenTheyArePassedToEntryAction)
   ASSERT_EQ(supplied_int, assigned_int);
 }
 
+TEST(StateMachine, WhenEntryActionsHaveDifferentParameters_ThenOnlyMatchingActionsExecute)
+{
+  TStateMachine sm(state::B);
+  auto x = sm.set_trigger_parameters<int>(trigger::X);
+  sm.configure(state::B).permit(trigger::X, state::C);
+
+  bool fired_without_parameters = false, fired_with_string = false;
+  int assigned_int = 0;
+  sm.configure(state::C)
+    .on_entry([&](const TStateMachine::TTransition&){ fired_without_parameters = true; })
+    .on_entry<std::string>(
+      [&](const TStateMachine::TTransition&, const std::string&){ fired_with_string = true; })
+    .on_entry_from(x, [&](const TStateMachine::TTransition&, int i){ assigned_int = i; });
+
+  sm.fire(x, 42);
+
+  ASSERT_FALSE(fired_without_parameters);
+  ASSERT_FALSE(fired_with_string);
+  ASSERT_EQ(42, assigned_int);
+}
+
+struct payload
+{
+  payload() {}
+  payload(const payload&) { ++copies; }
+  static int copies;
+};
+
+int payload::copies = 0;
+
+TEST(StateMachine, WhenParametersSuppliedToFire_ThenTheyAreNotCopied)
+{
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<payload>(trigger::X);
+  sm.configure(state::A)
+    .permit_dynamic(x, [](const payload&){ return state::B; });
+
+  int entered = 0;
+  sm.configure(state::B)
+    .sub_state_of(state::C)
+    .on_entry_from(x, [&](const TStateMachine::TTransition&, const payload&){ ++entered; });
+  sm.configure(state::C)
+    .on_entry<payload>([&](const TStateMachine::TTransition&, const payload&){ ++entered; });
+
+  payload p;
+  payload::copies = 0;
+  sm.fire(x, p);
+
+  ASSERT_EQ(state::B, sm.state());
+  ASSERT_EQ(2, entered);
+  ASSERT_EQ(0, payload::copies);
+}
+
 TEST(StateMachine, WhenUnhandledTriggerIsFired_ThenTheProvidedHandlerIsCalledWithStateAndTrigger)
 {
   TStateMachine sm(state::B);
@@ -237,4 +315,542 @@ TEST(StateMachine, WhenTransitionOccurs_ThenTheOnTransitionEventFires)
     sm.fire(trigger::X);
 }
 
+TEST(StateMachine, WhenFrozen_ThenTransitionsToConfiguredDestinationState)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).sub_state_of(state::C);
+  sm.configure(state::C).permit(trigger::Y, state::A);
+  sm.freeze();
+
+  ASSERT_TRUE(sm.is_frozen());
+  sm.fire(trigger::X);
+  ASSERT_EQ(state::B, sm.state());
+  ASSERT_TRUE(sm.can_fire(trigger::Y));
+  ASSERT_FALSE(sm.can_fire(trigger::X));
+  sm.fire(trigger::Y);
+  ASSERT_EQ(state::A, sm.state());
+}
+
+TEST(StateMachine, WhenFrozenStateHandlesManyTriggers_ThenEachResolvesToItsBehaviour)
+{
+  stateless::state_machine<int, int> sm(1);
+  for (int t = 0; t < 12; ++t)
+  {
+    sm.configure(0).permit(t, 100 + t);
+  }
+  sm.configure(1).sub_state_of(0).ignore(3).permit_reentry(4);
+  int transitions = 0;
+  sm.on_transition([&](const stateless::state_machine<int, int>::TTransition&) { ++transitions; });
+  sm.freeze();
+
+  ASSERT_EQ(fire_result::ignored, sm.try_fire(3));
+  ASSERT_EQ(1, sm.state());
+  ASSERT_EQ(fire_result::transitioned, sm.try_fire(4));
+  ASSERT_EQ(1, sm.state());
+  ASSERT_EQ(1, transitions);
+  ASSERT_EQ(fire_result::unhandled, sm.try_fire(20));
+  ASSERT_EQ(fire_result::transitioned, sm.try_fire(11));
+  ASSERT_EQ(111, sm.state());
+}
+
+TEST(StateMachine, WhenFrozen_ThenSubstateIsIncludedInCurrentState)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B).sub_state_of(state::C);
+  sm.freeze();
+
+  ASSERT_TRUE(sm.is_in_state(state::B));
+  ASSERT_TRUE(sm.is_in_state(state::C));
+  ASSERT_FALSE(sm.is_in_state(state::A));
+}
+
+TEST(StateMachine, WhenFrozen_ThenConfigurationRaisesError)
+{
+  TStateMachine sm(state::B);
+  sm.freeze();
+
+  ASSERT_THROW(sm.configure(state::B), stateless::error);
+  ASSERT_THROW(sm.set_trigger_parameters<int>(trigger::X), stateless::error);
+  ASSERT_THROW(sm.freeze(), stateless::error);
+}
+
+TEST(StateMachine, WhenFrozen_ThenPermitDestinationsNeedNoConfiguration)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.freeze();
+
+  sm.fire(trigger::X);
+  ASSERT_EQ(state::B, sm.state());
+}
+
+TEST(StateMachine, WhenFrozenAndEnteringUnconfiguredState_ThenRaisesError)
+{
+  state external = state::A;
+  TStateMachine sm([&]{ return external; }, [&](const state& s){ external = s; });
+  sm.configure(state::A).permit_dynamic(trigger::X, []{ return state::C; });
+  sm.freeze();
+
+  ASSERT_THROW(sm.fire(trigger::X), stateless::error);
+
+  external = state::C;
+  ASSERT_THROW(sm.state(), stateless::error);
+  ASSERT_THROW(sm.can_fire(trigger::X), stateless::error);
+}
+
+TEST(StateMachine, WhenFrozen_ThenQueriesMayRunConcurrentlyWithFiring)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).sub_state_of(state::C).permit(trigger::X, state::A);
+  sm.configure(state::C).permit(trigger::Y, state::A);
+  sm.freeze();
+
+  std::atomic<bool> done(false);
+  std::atomic<int> inconsistent(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r)
+  {
+    readers.push_back(std::thread([&]
+      {
+        while (!done)
+        {
+          const auto s = sm.state();
+          if (s != state::A && s != state::B)
+          {
+            ++inconsistent;
+          }
+          if (!sm.can_fire(trigger::X) || sm.permitted_triggers().empty())
+          {
+            ++inconsistent;
+          }
+          sm.is_in_state(state::C);
+          std::ostringstream oss;
+          oss << sm;
+        }
+      }));
+  }
+
+  for (int i = 0; i < 10000; ++i)
+  {
+    sm.fire(trigger::X);
+  }
+  done = true;
+  for (auto& reader : readers)
+  {
+    reader.join();
+  }
+
+  ASSERT_EQ(0, inconsistent);
+  ASSERT_EQ(state::A, sm.state());
+}
+
+TEST(StateMachine, WhenFrozen_ThenParametersArePassedToEntryAction)
+{
+  TStateMachine sm(state::B);
+  auto x = sm.set_trigger_parameters<int>(trigger::X);
+  int assigned_int = 0;
+  sm.configure(state::B).permit(trigger::X, state::C);
+  sm.configure(state::C)
+    .on_entry_from(x, [&](const TStateMachine::TTransition&, int i){ assigned_int = i; });
+  sm.freeze();
+
+  ASSERT_THROW(sm.fire(trigger::X), stateless::error);
+  sm.fire(x, 42);
+
+  ASSERT_EQ(42, assigned_int);
+}
+
+TEST(StateMachine, WhenTransitioningBetweenSiblingSubstates_ThenCommonSuperstateIsNotExitedOrEntered)
+{
+  TStateMachine sm(state::B);
+  std::vector<std::string> actual;
+  sm.configure(state::A)
+    .on_entry([&](const TStateMachine::TTransition&){ actual.push_back("enter A"); })
+    .on_exit([&](const TStateMachine::TTransition&){ actual.push_back("exit A"); });
+  sm.configure(state::B)
+    .sub_state_of(state::A)
+    .on_exit([&](const TStateMachine::TTransition&){ actual.push_back("exit B"); })
+    .permit(trigger::X, state::C);
+  sm.configure(state::C)
+    .sub_state_of(state::A)
+    .on_entry([&](const TStateMachine::TTransition&){ actual.push_back("enter C"); });
+  sm.freeze();
+  sm.fire(trigger::X);
+
+  ASSERT_EQ(2, actual.size());
+  EXPECT_EQ("exit B", actual.at(0));
+  EXPECT_EQ("enter C", actual.at(1));
+}
+
+TEST(StateMachine, WhenFrozenWithManyNestedStates_ThenIsInStateMatchesSuperstates)
+{
+  stateless::state_machine<int, int> sm(0);
+  for (int s = 1; s < 100; ++s)
+  {
+    sm.configure(s - 1).sub_state_of(s);
+  }
+  sm.configure(100);
+  sm.freeze();
+
+  for (int s = 0; s < 100; ++s)
+  {
+    EXPECT_TRUE(sm.is_in_state(s));
+  }
+  EXPECT_FALSE(sm.is_in_state(100));
+  EXPECT_FALSE(sm.is_in_state(101));
+}
+
+TEST(StateMachine, WhenFrozen_ThenIsInStateIdMatchesIsInState)
+{
+  stateless::state_machine<int, int> sm(0);
+  for (int s = 1; s < 100; ++s)
+  {
+    sm.configure(s - 1).sub_state_of(s);
+  }
+  sm.configure(100);
+  ASSERT_THROW(sm.state_id(0), stateless::error);
+  sm.freeze();
+
+  for (int s = 0; s < 100; ++s)
+  {
+    EXPECT_TRUE(sm.is_in_state_id(sm.state_id(s)));
+  }
+  EXPECT_FALSE(sm.is_in_state_id(sm.state_id(100)));
+  EXPECT_EQ((stateless::state_machine<int, int>::npos), sm.state_id(101));
+  EXPECT_FALSE(sm.is_in_state_id(sm.state_id(101)));
+}
+
+TEST(StateMachine, WhenForEachPermittedTriggerInSubstate_ThenEachTriggerIsVisitedOnce)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B).sub_state_of(state::C).permit(trigger::X, state::A);
+  sm.configure(state::C).permit(trigger::X, state::B).permit(trigger::Y, state::A);
+
+  std::vector<trigger> visited;
+  sm.for_each_permitted_trigger([&](const trigger& t){ visited.push_back(t); });
+
+  ASSERT_EQ(2, visited.size());
+  EXPECT_EQ(trigger::X, visited.at(0));
+  EXPECT_EQ(trigger::Y, visited.at(1));
+}
+
+TEST(StateMachine, WhenSubstateTriggerIsGuarded_ThenSuperstateTriggerIsStillVisited)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B).sub_state_of(state::C).permit_if(trigger::X, state::A, [](){ return false; });
+  sm.configure(state::C).permit(trigger::X, state::A);
+
+  std::vector<trigger> visited;
+  sm.for_each_permitted_trigger([&](const trigger& t){ visited.push_back(t); });
+
+  ASSERT_EQ(1, visited.size());
+  EXPECT_EQ(trigger::X, visited.at(0));
+}
+
+TEST(StateMachine, WhenForEachPermittedTriggerInNestedSubstate_ThenEachGuardIsEvaluatedAtMostOnce)
+{
+  TStateMachine sm(state::A);
+  int evaluations = 0;
+  auto unmet = [&](){ ++evaluations; return false; };
+  auto met = [&](){ ++evaluations; return true; };
+  sm.configure(state::A).sub_state_of(state::B)
+    .permit_if(trigger::X, state::C, unmet)
+    .permit_if(trigger::Y, state::C, unmet);
+  sm.configure(state::B).sub_state_of(state::C)
+    .permit_if(trigger::X, state::C, met)
+    .permit_if(trigger::Y, state::C, met);
+  sm.configure(state::C)
+    .permit_if(trigger::X, state::A, met)
+    .permit_if(trigger::Y, state::A, met);
+
+  std::vector<trigger> visited;
+  sm.for_each_permitted_trigger([&](const trigger& t){ visited.push_back(t); });
+
+  ASSERT_EQ(std::vector<trigger>({ trigger::X, trigger::Y }), visited);
+  EXPECT_EQ(4, evaluations);
+}
+
+TEST(StateMachine, WhenFrozen_ThenPermittedTriggerMaskIsIndexedByTriggerId)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::A).permit(trigger::Z, state::B);
+  sm.configure(state::B).sub_state_of(state::C).permit(trigger::X, state::A);
+  sm.configure(state::C).permit(trigger::Y, state::A);
+  sm.freeze();
+
+  std::vector<bool> mask;
+  sm.permitted_trigger_mask(mask);
+
+  ASSERT_EQ(3, mask.size());
+  EXPECT_TRUE(mask.at(sm.trigger_id(trigger::X)));
+  EXPECT_TRUE(mask.at(sm.trigger_id(trigger::Y)));
+  EXPECT_FALSE(mask.at(sm.trigger_id(trigger::Z)));
+}
+
+TEST(StateMachine, WhenNotFrozen_ThenPermittedTriggerMaskThrows)
+{
+  TStateMachine sm(state::B);
+  std::vector<bool> mask;
+
+  ASSERT_THROW(sm.permitted_trigger_mask(mask), stateless::error);
+  ASSERT_THROW(sm.trigger_id(trigger::X), stateless::error);
+}
+
+TEST(StateMachine, WhenCanFireMany_ThenResultPerTriggerIsWritten)
+{
+  TStateMachine sm(state::B);
+  sm.configure(state::B).sub_state_of(state::C).permit(trigger::X, state::A);
+  sm.configure(state::C).permit(trigger::Y, state::A);
+
+  const std::vector<trigger> triggers = { trigger::Z, trigger::Y, trigger::X };
+  std::vector<bool> result;
+  sm.can_fire_many(triggers.begin(), triggers.end(), std::back_inserter(result));
+
+  ASSERT_EQ(3, result.size());
+  EXPECT_FALSE(result.at(0));
+  EXPECT_TRUE(result.at(1));
+  EXPECT_TRUE(result.at(2));
+}
+
+TEST(StateMachine, WhenPrintedInSubstate_ThenPermittedTriggersAreSorted)
+{
+  stateless::state_machine<std::string, std::string> sm("B");
+  sm.configure("B").sub_state_of("C").permit("y", "A");
+  sm.configure("C").permit("x", "A");
+
+  std::ostringstream oss;
+  oss << sm;
+
+  ASSERT_EQ("state_machine { state = B, permitted triggers = { x, y } }", oss.str());
+}
+
+TEST(StateMachine, WhenTryFirePermittedTrigger_ThenTransitionedIsReturned)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+
+  ASSERT_EQ(fire_result::transitioned, sm.try_fire(trigger::X));
+  ASSERT_EQ(state::B, sm.state());
+}
+
+TEST(StateMachine, WhenTryFireIgnoredTrigger_ThenIgnoredIsReturned)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).ignore(trigger::X);
+
+  ASSERT_EQ(fire_result::ignored, sm.try_fire(trigger::X));
+  ASSERT_EQ(state::A, sm.state());
+}
+
+TEST(StateMachine, WhenTryFireUnhandledTrigger_ThenUnhandledIsReturnedWithoutCallingHandler)
+{
+  TStateMachine sm(state::A);
+  bool called = false;
+  sm.on_unhandled_trigger([&](const state&, const trigger&){ called = true; });
+
+  ASSERT_EQ(fire_result::unhandled, sm.try_fire(trigger::X));
+  ASSERT_FALSE(called);
+}
+
+TEST(StateMachine, WhenTryFireWithOverlappingGuards_ThenGuardConflictIsReturned)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A)
+    .permit_if(trigger::X, state::B, [](){ return true; })
+    .permit_if(trigger::X, state::C, [](){ return true; });
+
+  ASSERT_EQ(fire_result::guard_conflict, sm.try_fire(trigger::X));
+  ASSERT_THROW(sm.fire(trigger::X), stateless::error);
+
+  sm.freeze();
+  ASSERT_EQ(fire_result::guard_conflict, sm.try_fire(trigger::X));
+  ASSERT_EQ(state::A, sm.state());
+}
+
+TEST(StateMachine, WhenTryFireWithWrongParameters_ThenBadParametersIsReturned)
+{
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<int>(trigger::X);
+  sm.configure(state::A).permit(trigger::X, state::B);
+
+  ASSERT_EQ(fire_result::bad_parameters, sm.try_fire(trigger::X));
+  ASSERT_EQ(fire_result::transitioned, sm.try_fire(x, 1));
+}
+
+TEST(StateMachine, WhenErrorHandlerIsInstalled_ThenErrorsAreReportedToIt)
+{
+  struct custom_error {};
+  auto previous = stateless::set_error_handler([](const char*){ throw custom_error(); });
+  TStateMachine sm(state::A);
+
+  EXPECT_THROW(sm.fire(trigger::X), custom_error);
+
+  stateless::set_error_handler(previous);
+  EXPECT_THROW(sm.fire(trigger::X), stateless::error);
+}
+
+TEST(StateMachine, WhenTriggersAreDeferredFromOtherThreads_ThenDrainFiresThemAll)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::X, state::A);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.push_back(std::thread([&sm]
+      {
+        for (int i = 0; i < 25; ++i)
+        {
+          while (!sm.push_deferred_trigger(trigger::X))
+          {
+            std::this_thread::yield();
+          }
+        }
+      }));
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_EQ(1, sm.drain_deferred_triggers(1));
+  ASSERT_EQ(99, sm.drain_deferred_triggers());
+  ASSERT_EQ(state::A, sm.state());
+  ASSERT_FALSE(sm.pop_deferred_trigger());
+}
+
+TEST(StateMachine, WhenDeferredTriggerFailsToFire_ThenItRemainsQueued)
+{
+  TStateMachine sm(state::A);
+  ASSERT_TRUE(sm.push_deferred_trigger(trigger::X));
+  ASSERT_THROW(sm.pop_deferred_trigger(), stateless::error);
+
+  sm.configure(state::A).permit(trigger::X, state::B);
+  ASSERT_TRUE(sm.pop_deferred_trigger());
+  ASSERT_EQ(state::B, sm.state());
+  ASSERT_FALSE(sm.pop_deferred_trigger());
+}
+
+TEST(StateMachine, WhenFireAll_ThenTriggersAreAppliedInOrder)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::Y, state::C).ignore(trigger::X);
+
+  const std::vector<trigger> triggers = { trigger::X, trigger::X, trigger::Y };
+  auto result = sm.fire_all(triggers.begin(), triggers.end());
+
+  EXPECT_EQ(3, result.consumed);
+  EXPECT_EQ(0, result.failed);
+  EXPECT_EQ(fire_result::transitioned, result.last_result);
+  EXPECT_EQ(state::C, sm.state());
+}
+
+TEST(StateMachine, WhenExternalStateChangesDuringFireAll_ThenNextTriggerSeesIt)
+{
+  state external = state::A;
+  TStateMachine sm([&]{ return external; }, [&](const state& s){ external = s; });
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).on_entry([&](const TStateMachine::TTransition&){ external = state::C; });
+  sm.configure(state::C).permit(trigger::Y, state::A);
+  sm.freeze();
+
+  const std::vector<trigger> triggers = { trigger::X, trigger::Y };
+  auto result = sm.fire_all(triggers);
+
+  EXPECT_EQ(2, result.consumed);
+  EXPECT_EQ(0, result.failed);
+  EXPECT_EQ(state::A, sm.state());
+}
+
+TEST(StateMachine, WhenFireAllStopsOnFailure_ThenRemainingTriggersAreNotConsumed)
+{
+  TStateMachine sm(state::A);
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B).permit(trigger::X, state::A);
+  sm.freeze();
+
+  const trigger triggers[] = { trigger::X, trigger::Z, trigger::X };
+  auto result = sm.fire_all(triggers);
+
+  EXPECT_EQ(2, result.consumed);
+  EXPECT_EQ(1, result.failed);
+  EXPECT_EQ(fire_result::unhandled, result.last_result);
+  EXPECT_EQ(state::B, sm.state());
+}
+
+TEST(StateMachine, WhenFireAllContinuesOnFailure_ThenAllTriggersAreConsumed)
+{
+  std::string external("A");
+  stateless::state_machine<std::string, std::string> sm(
+    [&]{ return external; },
+    [&](const std::string& s){ external = s; });
+  sm.configure("A").permit("x", "B");
+  sm.configure("B").permit("x", "A");
+
+  const std::vector<std::string> triggers = { "x", "z", "x", "x" };
+  auto result = sm.fire_all(triggers, stateless::batch_policy::continue_on_failure);
+
+  EXPECT_EQ(4, result.consumed);
+  EXPECT_EQ(1, result.failed);
+  EXPECT_EQ(fire_result::transitioned, result.last_result);
+  EXPECT_EQ("B", external);
+}
+
+
+TEST(StateMachine, WhenEntryActionPostedToStrand_ThenFireReturnsBeforeItRuns)
+{
+  std::vector<strand::TTask> posted;
+  strand actions([&](const strand::TTask& task) { posted.push_back(task); });
+  TStateMachine sm(state::A);
+  std::vector<std::string> order;
+  sm.configure(state::A)
+    .permit(trigger::X, state::B)
+    .on_exit(actions, [&](const TStateMachine::TTransition&) { order.push_back("exit A"); });
+  sm.configure(state::B)
+    .permit(trigger::Y, state::A)
+    .on_entry(actions, [&](const TStateMachine::TTransition& t)
+      {
+        ASSERT_EQ(state::A, t.source());
+        order.push_back("enter B");
+      })
+    .on_exit([&](const TStateMachine::TTransition&) { order.push_back("exit B"); });
+
+  sm.fire(trigger::X);
+  sm.fire(trigger::Y);
+
+  ASSERT_EQ(state::A, sm.state());
+  ASSERT_EQ(std::vector<std::string>({ "exit B" }), order);
+  ASSERT_EQ(1U, posted.size());
+  posted.front()();
+  ASSERT_EQ(std::vector<std::string>({ "exit B", "exit A", "enter B" }), order);
+  ASSERT_TRUE(actions.is_idle());
+}
+
+TEST(StateMachine, WhenParameterisedEntryActionPostedToStrand_ThenArgumentsAreCopied)
+{
+  std::vector<strand::TTask> posted;
+  strand actions([&](const strand::TTask& task) { posted.push_back(task); });
+  TStateMachine sm(state::A);
+  auto x = sm.set_trigger_parameters<std::string>(trigger::X);
+  std::string received;
+  sm.configure(state::A).permit(trigger::X, state::B);
+  sm.configure(state::B)
+    .on_entry_from(actions, x, [&](const TStateMachine::TTransition&, const std::string& s)
+      {
+        received = s;
+      });
+
+  {
+    std::string argument("copied");
+    sm.fire(x, argument);
+  }
+  posted.front()();
+
+  ASSERT_EQ("copied", received);
+}
+
 }
@@ -0,0 +1,206 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/state_machine_pool.hpp>
+
+#include <vector>
+
+#include <state.hpp>
+#include <trigger.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+using namespace testing;
+
+namespace
+{
+
+#ifdef _WIN32
+typedef machine_definition<state, trigger> TDefinition;
+typedef state_machine_pool<state, trigger> TPool;
+#else
+using TDefinition = machine_definition<state, trigger>;
+using TPool = state_machine_pool<state, trigger>;
+#endif
+
+TEST(StateMachinePool, WhenConstructed_ThenAllInstancesAreInInitialState)
+{
+  TDefinition definition;
+  definition.configure(state::A);
+  definition.freeze();
+
+  TPool pool(definition, 3, state::A);
+
+  ASSERT_EQ(3U, pool.size());
+  for (std::size_t id = 0; id < pool.size(); ++id)
+  {
+    ASSERT_EQ(state::A, pool.state(id));
+  }
+}
+
+TEST(StateMachinePool, WhenDefinitionNotFrozen_ThenConstructionRaisesError)
+{
+  TDefinition definition;
+  definition.configure(state::A);
+
+  ASSERT_THROW(TPool(definition, 3, state::A), stateless::error);
+}
+
+TEST(StateMachinePool, WhenFireAllInstances_ThenOnlyTransitioningInstancesRunActions)
+{
+  TDefinition definition;
+  int exits = 0, entries = 0;
+  definition.configure(state::A)
+    .permit(trigger::X, state::B)
+    .on_exit([&](const TDefinition::TTransition&) { ++exits; });
+  definition.configure(state::B)
+    .ignore(trigger::X)
+    .on_entry([&](const TDefinition::TTransition&) { ++entries; });
+  definition.configure(state::C);
+  definition.freeze();
+
+  TPool pool(definition, 4, state::A);
+  pool.add(state::B);
+  pool.add(state::C);
+
+  auto result = pool.fire_all_instances(trigger::X);
+
+  ASSERT_EQ(6U, result.consumed);
+  ASSERT_EQ(1U, result.failed);
+  ASSERT_EQ(fire_result::unhandled, result.last_result);
+  ASSERT_EQ(4, exits);
+  ASSERT_EQ(4, entries);
+  for (std::size_t id = 0; id < 5; ++id)
+  {
+    ASSERT_EQ(state::B, pool.state(id));
+  }
+  ASSERT_EQ(state::C, pool.state(5));
+}
+
+TEST(StateMachinePool, WhenStopOnFailure_ThenFireAllInstancesStopsAtFirstUnhandled)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::C);
+  definition.freeze();
+
+  TPool pool(definition, 2, state::A);
+  pool.add(state::C);
+  pool.add(state::A);
+
+  auto result = pool.fire_all_instances(trigger::X, batch_policy::stop_on_failure);
+
+  ASSERT_EQ(3U, result.consumed);
+  ASSERT_EQ(1U, result.failed);
+  ASSERT_EQ(state::B, pool.state(1));
+  ASSERT_EQ(state::A, pool.state(3));
+}
+
+TEST(StateMachinePool, WhenFireIdsAndTriggers_ThenEachInstanceReceivesItsTrigger)
+{
+  TDefinition definition;
+  definition.configure(state::A)
+    .permit(trigger::X, state::B)
+    .permit(trigger::Y, state::C);
+  definition.configure(state::B).sub_state_of(state::C);
+  definition.freeze();
+
+  TPool pool(definition, 4, state::A);
+  std::vector<std::size_t> transitioned;
+  pool.on_transition([&](std::size_t id, const TDefinition::TTransition& transition)
+    {
+      ASSERT_EQ(state::A, transition.source());
+      transitioned.push_back(id);
+    });
+
+  const std::size_t ids[] = { 3, 1, 2 };
+  const trigger triggers[] = { trigger::X, trigger::X, trigger::Y };
+  auto result = pool.fire(ids, triggers);
+
+  ASSERT_EQ(3U, result.consumed);
+  ASSERT_EQ(0U, result.failed);
+  ASSERT_EQ(state::A, pool.state(0));
+  ASSERT_EQ(state::B, pool.state(1));
+  ASSERT_EQ(state::C, pool.state(2));
+  ASSERT_EQ(state::B, pool.state(3));
+  ASSERT_TRUE(pool.is_in_state(3, state::C));
+  ASSERT_EQ(std::vector<std::size_t>({ 3, 1, 2 }), transitioned);
+}
+
+TEST(StateMachinePool, WhenInstanceTransitions_ThenActionsAndCallbackSeeItsIdentifier)
+{
+  TDefinition definition;
+  std::vector<std::size_t> entered;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.configure(state::B)
+    .permit_reentry(trigger::Y)
+    .on_entry([&](const TDefinition::TTransition& t) { entered.push_back(t.instance_id()); });
+  definition.freeze();
+
+  TPool pool(definition, 3, state::A);
+  pool.add(state::B);
+  std::vector<std::size_t> reported;
+  pool.on_transition([&](std::size_t id, const TDefinition::TTransition& transition)
+    {
+      ASSERT_EQ(id, transition.instance_id());
+      ASSERT_EQ(state::B, transition.destination());
+      ASSERT_EQ(entered.back(), id);
+      reported.push_back(id);
+    });
+
+  const std::size_t ids[] = { 2, 3, 0 };
+  const trigger triggers[] = { trigger::X, trigger::Y, trigger::X };
+  pool.fire(ids, triggers);
+
+  ASSERT_EQ(std::vector<std::size_t>({ 2, 3, 0 }), entered);
+  ASSERT_EQ(std::vector<std::size_t>({ 2, 3, 0 }), reported);
+}
+
+TEST(StateMachinePool, WhenIdsAndTriggersDifferInLength_ThenRaisesError)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.freeze();
+
+  TPool pool(definition, 2, state::A);
+  const std::size_t ids[] = { 0, 1 };
+  const trigger triggers[] = { trigger::X };
+
+  ASSERT_THROW(pool.fire(ids, triggers), stateless::error);
+}
+
+TEST(StateMachinePool, WhenIdentifierIsOutsidePool_ThenRaisesError)
+{
+  TDefinition definition;
+  definition.configure(state::A).permit(trigger::X, state::B);
+  definition.freeze();
+
+  TPool pool(definition, 2, state::A);
+  const std::size_t ids[] = { 0, 2 };
+  const trigger triggers[] = { trigger::X, trigger::X };
+  std::vector<instance_failure> failures;
+
+  ASSERT_THROW(pool.state(2), stateless::error);
+  ASSERT_THROW(pool.is_in_state(2, state::A), stateless::error);
+  ASSERT_THROW(pool.fire(ids, triggers), stateless::error);
+  ASSERT_EQ(state::B, pool.state(0));
+  ASSERT_THROW(pool.fire_instances(1, 3, trigger::X, failures), stateless::error);
+  ASSERT_EQ(state::A, pool.state(1));
+}
+
+}
@@ -42,7 +42,8 @@ using TTB = trigger_behaviour<state, trigger>;
 
 TEST(StateRepresentation, WhenEntering_ThenEnteringActionsExecute)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
   TTransition t(state::A, state::B, trigger::X);
   bool executed = false;
   sr.add_entry_action([&](const TTransition&){ executed = true; });
@@ -52,7 +53,8 @@ TEST(StateRepresentation, WhenEntering_ThenEnteringActionsExecute)
 
 TEST(StateRepresentation, WhenLeaving_ThenEnteringActionsDoNotExecute)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
   TTransition t(state::A, state::B, trigger::X);
   bool executed = false;
   sr.add_entry_action([&](const TTransition&){ executed = true; });
@@ -62,7 +64,8 @@ TEST(StateRepresentation, WhenLeaving_ThenEnteringActionsDoNotExecute)
 
 TEST(StateRepresentation, WhenLeaving_ThenLeavingActionsExecute)
 {
-  TSR sr(state::A);
+  arena a;
+  TSR sr(state::A, a);
   TTransition t(state::A, state::B, trigger::X);
   bool executed = false;
   sr.add_exit_action([&](const TTransition&){ executed = true; });
@@ -72,7 +75,8 @@ TEST(StateRepresentation, WhenLeaving_ThenLeavingActionsExecute)
 
 TEST(StateRepresentation, WhenEntering_ThenLeavingActionsDoNotExecute)
 {
-  TSR sr(state::A);
+  arena a;
+  TSR sr(state::A, a);
   TTransition t(state::A, state::B, trigger::X);
   bool executed = false;
   sr.add_exit_action([&](const TTransition&){ executed = true; });
@@ -83,22 +87,25 @@ TEST(StateRepresentation, WhenEntering_ThenLeavingActionsDoNotExecute)
 
 TEST(StateRepresentation, WhenSetup_ThenIncludesUnderlyingState)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
 
   ASSERT_TRUE(sr.includes(state::B));
 }
 
 TEST(StateRepresentation, WhenSetup_ThenDoesNotIncludeUnrelatedState)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
 
   ASSERT_FALSE(sr.includes(state::C));
 }
 
 TEST(StateRepresentation, WhenSubstate_ThenIncludesSubstate)
 {
-  TSR sr_b(state::B);
-  TSR sr_c(state::C);
+  arena a;
+  TSR sr_b(state::B, a);
+  TSR sr_c(state::C, a);
   sr_b.add_sub_state(&sr_c);
 
   ASSERT_TRUE(sr_b.includes(state::C));
@@ -106,8 +113,9 @@ TEST(StateRepresentation, WhenSubstate_ThenIncludesSubstate)
 
 TEST(StateRepresentation, WhenSuperstate_ThenDoesNotIncludeSuperstate)
 {
-  TSR sr_b(state::B);
-  TSR sr_c(state::C);
+  arena a;
+  TSR sr_b(state::B, a);
+  TSR sr_c(state::C, a);
   sr_b.set_super_state(&sr_c);
 
   ASSERT_FALSE(sr_b.includes(state::C));
@@ -115,22 +123,25 @@ TEST(StateRepresentation, WhenSuperstate_ThenDoesNotIncludeSuperstate)
 
 TEST(StateRepresentation, WhenSetup_ThenIsIncludedInUnderlyingState)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
   
   ASSERT_TRUE(sr.is_included_in(state::B));
 }
 
 TEST(StateRepresentation, WhenSetup_ThenIsNotIncludedInUnrelatedState)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
   
   ASSERT_FALSE(sr.is_included_in(state::C));
 }
 
 TEST(StateRepresentation, WhenSubstate_ThenIsNotIncludedInSubstate)
 {
-  TSR sr_b(state::B);
-  TSR sr_c(state::C);
+  arena a;
+  TSR sr_b(state::B, a);
+  TSR sr_c(state::C, a);
   sr_b.add_sub_state(&sr_c);
   
   ASSERT_FALSE(sr_b.is_included_in(state::C));
@@ -138,15 +149,17 @@ TEST(StateRepresentation, WhenSubstate_ThenIsNotIncludedInSubstate)
 
 TEST(StateRepresentation, WhenSuperstate_ThenIsIncludedInSuperstate)
 {
-  TSR sr_b(state::B);
-  TSR sr_c(state::C);
+  arena a;
+  TSR sr_b(state::B, a);
+  TSR sr_c(state::C, a);
   sr_b.set_super_state(&sr_c);
   
   ASSERT_TRUE(sr_b.is_included_in(state::C));
 }
 
 #define CREATE_SUPER_SUB_PAIR() \
-  TSR super(state::A), sub(state::B); \
+  arena a; \
+  TSR super(state::A, a), sub(state::B, a); \
   super.add_sub_state(&sub); \
   sub.set_super_state(&super);
 
@@ -218,9 +231,10 @@ TEST(StateRepresentation, WhenLeavingSubstate_ThenSuperExitActionsExecute)
 
 TEST(StateRepresentation, WhenEntering_ThenEntryActionsExecuteInOrder)
 {
+  arena a;
   std::vector<int> actual;
   
-  TSR sr(state::B);
+  TSR sr(state::B, a);
   sr.add_entry_action([&](const TTransition&){ actual.push_back(0); });
   sr.add_entry_action([&](const TTransition&){ actual.push_back(1); });
   
@@ -233,9 +247,10 @@ TEST(StateRepresentation, WhenEntering_ThenEntryActionsExecuteInOrder)
 
 TEST(StateRepresentation, WhenLeaving_ThenExitActionsExecuteInOrder)
 {
+  arena a;
   std::vector<int> actual;
   
-  TSR sr(state::B);
+  TSR sr(state::B, a);
   sr.add_exit_action([&](const TTransition&){ actual.push_back(0); });
   sr.add_exit_action([&](const TTransition&){ actual.push_back(1); });
   
@@ -248,8 +263,9 @@ TEST(StateRepresentation, WhenLeaving_ThenExitActionsExecuteInOrder)
 
 TEST(StateRepresentation, WhenTransitionExists_ThenTriggerCanBeFired)
 {
-  TSR sr(state::B);
-  auto tb = std::make_shared<TTB>(
+  arena a;
+  TSR sr(state::B, a);
+  auto tb = a.create<TTB>(
     trigger::X, [](){ return true; }, [](const state&, state&){ return false; });
   sr.add_trigger_behaviour(trigger::X, tb);
 
@@ -259,18 +275,20 @@ TEST(StateRepresentation, WhenTransitionExists_ThenTriggerCanBeFired)
 
 TEST(StateRepresentation, WhenTransitionDoesNotExist_ThenTriggerCannotBeFired)
 {
-  TSR sr(state::B);
+  arena a;
+  TSR sr(state::B, a);
 
   ASSERT_FALSE(sr.can_handle(trigger::X));
 }
 
 TEST(StateRepresentation, WhenTransitionExistsInSupersate_ThenTriggerCanBeFired)
 {
-  TSR sr_b(state::B);
-  auto tb = std::make_shared<TTB>(
+  arena a;
+  TSR sr_b(state::B, a);
+  auto tb = a.create<TTB>(
     trigger::X, [](){ return true; }, [](const state&, state&){ return false; });
   sr_b.add_trigger_behaviour(trigger::X, tb);
-  TSR sub(state::C);
+  TSR sub(state::C, a);
   sub.set_super_state(&sr_b);
   sr_b.add_sub_state(&sub);
   
@@ -301,4 +319,55 @@ TEST(StateRepresentation, WhenExitingSubstate_ThenSubstateEntryActionsExecuteBef
   ASSERT_LT(sub_order, super_order);
 }
 
+TEST(StateRepresentation, WhenSuperstateIsNestedLater_ThenSubstateAncestorsAreUpdated)
+{
+  arena a;
+  TSR sr_a(state::A, a), sr_b(state::B, a), sr_c(state::C, a);
+  sr_c.set_super_state(&sr_b);
+  sr_b.add_sub_state(&sr_c);
+  sr_b.set_super_state(&sr_a);
+  sr_a.add_sub_state(&sr_b);
+
+  ASSERT_EQ(2, sr_c.depth());
+  ASSERT_EQ(3, sr_c.ancestors().size());
+  EXPECT_EQ(&sr_a, sr_c.ancestors().at(0));
+  EXPECT_EQ(&sr_b, sr_c.ancestors().at(1));
+  EXPECT_EQ(&sr_c, sr_c.ancestors().at(2));
+}
+
+TEST(StateRepresentation, WhenSuperstateIsASubstate_ThenThrows)
+{
+  arena a;
+  TSR sr_a(state::A, a), sr_b(state::B, a);
+  sr_b.set_super_state(&sr_a);
+  sr_a.add_sub_state(&sr_b);
+
+  ASSERT_THROW(sr_a.set_super_state(&sr_b), stateless::error);
+  ASSERT_THROW(sr_a.set_super_state(&sr_a), stateless::error);
+}
+
+TEST(StateRepresentation, WhenTransitioningBetweenSiblings_ThenOnlyStatesBelowCommonSuperstateAreExitedAndEntered)
+{
+  arena a;
+  TSR root(state::A, a), left(state::B, a), right(state::C, a);
+  left.set_super_state(&root);
+  root.add_sub_state(&left);
+  right.set_super_state(&root);
+  root.add_sub_state(&right);
+
+  std::vector<state> actual;
+  root.add_entry_action([&](const TTransition&){ actual.push_back(state::A); });
+  root.add_exit_action([&](const TTransition&){ actual.push_back(state::A); });
+  left.add_exit_action([&](const TTransition&){ actual.push_back(state::B); });
+  right.add_entry_action([&](const TTransition&){ actual.push_back(state::C); });
+
+  TTransition transition(state::B, state::C, trigger::X);
+  left.exit_to(transition, &right);
+  right.enter_from(transition, &left);
+
+  ASSERT_EQ(2, actual.size());
+  EXPECT_EQ(state::B, actual.at(0));
+  EXPECT_EQ(state::C, actual.at(1));
+}
+
 }
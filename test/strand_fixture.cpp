@@ -0,0 +1,161 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/strand.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace stateless;
+
+namespace
+{
+
+/// Executor running tasks on a few threads in no particular order.
+class thread_executor
+{
+public:
+  explicit thread_executor(std::size_t threads)
+    : stopping_(false)
+  {
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+      threads_.push_back(std::thread([this]{ run(); }));
+    }
+  }
+
+  ~thread_executor()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    available_.notify_all();
+    for (auto& t : threads_)
+    {
+      t.join();
+    }
+  }
+
+  void post(const strand::TTask& task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(task);
+    }
+    available_.notify_one();
+  }
+
+private:
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+      available_.wait(lock, [this]{ return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty())
+      {
+        return;
+      }
+      auto task = tasks_.front();
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable available_;
+  std::deque<strand::TTask> tasks_;
+  bool stopping_;
+};
+
+TEST(Strand, WhenExecutorRunsTasksImmediately_ThenTasksRunInPostOrder)
+{
+  strand s([](const strand::TTask& task) { task(); });
+  std::vector<int> order;
+
+  s.post([&]
+    {
+      order.push_back(1);
+      s.post([&]{ order.push_back(3); });
+      order.push_back(2);
+    });
+
+  ASSERT_TRUE(s.is_idle());
+  ASSERT_EQ(std::vector<int>({ 1, 2, 3 }), order);
+}
+
+TEST(Strand, WhenExecutorHasManyThreads_ThenTasksRunOneAtATimeInOrder)
+{
+  thread_executor executor(4);
+  strand s([&](const strand::TTask& task) { executor.post(task); });
+  std::vector<int> order;
+  std::atomic<int> running(0);
+  std::atomic<bool> overlapped(false);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    s.post([&, i]
+      {
+        if (++running != 1)
+        {
+          overlapped = true;
+        }
+        order.push_back(i);
+        --running;
+      });
+  }
+  s.wait();
+
+  ASSERT_FALSE(overlapped);
+  ASSERT_EQ(1000U, order.size());
+  for (int i = 0; i < 1000; ++i)
+  {
+    ASSERT_EQ(i, order[i]);
+  }
+}
+
+TEST(Strand, WhenTaskThrows_ThenLaterTasksStillRun)
+{
+  std::deque<strand::TTask> queued;
+  strand s([&](const strand::TTask& task) { queued.push_back(task); });
+  bool ran = false;
+  s.post([]{ throw std::runtime_error("action failed"); });
+  s.post([&]{ ran = true; });
+
+  ASSERT_EQ(1U, queued.size());
+  auto first = queued.front();
+  queued.pop_front();
+  ASSERT_THROW(first(), std::runtime_error);
+
+  ASSERT_EQ(1U, queued.size());
+  queued.front()();
+  ASSERT_TRUE(ran);
+  ASSERT_TRUE(s.is_idle());
+}
+
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright 2013 Matt Mason
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stateless++/detail/transition_kernel.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace stateless::detail;
+
+namespace
+{
+
+const std::uint32_t no_transition = 0xFFFFFFFF;
+
+std::vector<simd_level> supported_levels()
+{
+  std::vector<simd_level> levels(1, simd_level::scalar);
+  const auto detected = detected_simd_level();
+  if (detected == simd_level::sse42 || detected == simd_level::avx2)
+  {
+    levels.push_back(simd_level::sse42);
+  }
+  if (detected == simd_level::avx2)
+  {
+    levels.push_back(simd_level::avx2);
+  }
+  return levels;
+}
+
+template<typename TStateStorage>
+void check_levels_agree(std::size_t state_count, std::size_t count)
+{
+  std::vector<std::uint32_t> next(state_count);
+  for (std::size_t s = 0; s < state_count; ++s)
+  {
+    next[s] = s % 3 == 0 ? static_cast<std::uint32_t>(s)
+      : s % 3 == 1 ? static_cast<std::uint32_t>((s * 7 + 1) % state_count)
+      : no_transition;
+  }
+  std::vector<TStateStorage> states(count);
+  std::uint32_t seed = 12345;
+  for (auto& state : states)
+  {
+    seed = seed * 1103515245 + 12345;
+    state = static_cast<TStateStorage>((seed >> 16) % state_count);
+  }
+
+  std::vector<std::uint32_t> expected(count);
+  expected.resize(select_changed_scalar(states.data(), 0, count, next.data(), expected.data(), 0));
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const bool reported = std::find(expected.begin(), expected.end(), i) != expected.end();
+    ASSERT_EQ(next[states[i]] != states[i], reported);
+  }
+
+  for (auto level : supported_levels())
+  {
+    std::vector<std::uint32_t> changed(count);
+    changed.resize(select_changed(
+      level, states.data(), count, next.data(), state_count, changed.data()));
+    ASSERT_EQ(expected, changed) << "level " << static_cast<int>(level);
+  }
+}
+
+TEST(TransitionKernel, WhenFewByteStates_ThenAllLevelsReportTheSameIndices)
+{
+  check_levels_agree<std::uint8_t>(5, 1000);
+}
+
+TEST(TransitionKernel, WhenManyByteStates_ThenAllLevelsReportTheSameIndices)
+{
+  check_levels_agree<std::uint8_t>(256, 1037);
+}
+
+TEST(TransitionKernel, WhenFewWordStates_ThenAllLevelsReportTheSameIndices)
+{
+  check_levels_agree<std::uint16_t>(16, 999);
+}
+
+TEST(TransitionKernel, WhenManyWordStates_ThenAllLevelsReportTheSameIndices)
+{
+  check_levels_agree<std::uint16_t>(3000, 4101);
+}
+
+TEST(TransitionKernel, WhenFewerStatesThanVectorWidth_ThenTailIsScanned)
+{
+  check_levels_agree<std::uint8_t>(4, 7);
+}
+
+}
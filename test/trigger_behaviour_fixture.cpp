@@ -60,4 +60,23 @@ TEST(TriggerBehaviour, WhenGuardConditionTrue_ThenIsGuardConditionMetIsTrue)
   ASSERT_TRUE(trigger_behaviour.is_condition_met());
 }
 
+TEST(TriggerBehaviour, WhenGuardIsEmpty_ThenIsUnguardedAndConditionIsMet)
+{
+  TTB trigger_behaviour(
+    trigger::X,
+    TTB::TGuard(),
+    [](const state& source, state& destination) { return true; });
+  ASSERT_FALSE(trigger_behaviour.is_guarded());
+  ASSERT_TRUE(trigger_behaviour.is_condition_met());
+}
+
+TEST(TriggerBehaviour, WhenGuardIsSet_ThenIsGuarded)
+{
+  TTB trigger_behaviour(
+    trigger::X,
+    []() { return true; },
+    [](const state& source, state& destination) { return true; });
+  ASSERT_TRUE(trigger_behaviour.is_guarded());
+}
+
 }